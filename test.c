@@ -25,7 +25,7 @@ static void vdebug_print_raw_mem(Vec *vec)
 
 	for (size_t i = 0; i < vec->len * vec->elem_size; i++)
 	{
-		printf("%02X ", ((char *)vec->data)[i]);
+		printf("%02X ", ((char *)vec->first)[i]);
 
 		if (((i + 1) & (vec->elem_size - 1)) == 0)
 		{
@@ -35,6 +35,43 @@ static void vdebug_print_raw_mem(Vec *vec)
 	printf("\n\n");
 }
 
+static void *vdebug_destroy_iter(void *iter)
+{
+	vi_destroy(iter);
+
+	return NULL;
+}
+
+static bool vdebug_is_odd(const void *elem, void *calls)
+{
+	(*(size_t *)calls)++;
+
+	return (*(const int *)elem & 1);
+}
+
+static void vdebug_square(void *dest, const void *elem, void *ctx)
+{
+	(void) ctx;
+
+	*(int64_t *)dest = (int64_t) *(const int32_t *)elem * *(const int32_t *)elem;
+}
+
+static void vdebug_count_range(void *elems, size_t count, size_t index, void *total)
+{
+	(void) elems;
+	(void) index;
+
+	__atomic_add_fetch((size_t *)total, count, __ATOMIC_RELAXED);
+}
+
+static int vdebug_cmp_int(const void *a, const void *b)
+{
+	int x = *(const int *)a;
+	int y = *(const int *)b;
+
+	return (x > y) - (x < y);
+}
+
 
 int main(void)
 {
@@ -180,6 +217,8 @@ int main(void)
 	vdebug_print_info(vec);
 	vdebug_print_raw_mem(vec);
 
+	v_perror("Prepend overflowing the capacity", v_prepend(vec, &prepended, SIZE_MAX / 2));
+
 	int appended[] = {0x1, 0x2, 0x3, 0x4};
 	v_append(vec, &appended, 4);
 	printf("Appended :");
@@ -195,6 +234,160 @@ int main(void)
 	v_last(vec, &last);
 	printf("Last is : 0x%x\n", last);
 
+	v_remove(vec, &removed, 0);
+	printf("Removed at [0] : 0x%x\n", removed);
+
+	vdebug_print_info(vec);
+	vdebug_print_raw_mem(vec);
+
+	insert = 0x99;
+	v_insert(vec, &insert, 1);
+	printf("Inserted at [1] : 0x%x\n", insert);
+
+	vdebug_print_info(vec);
+	vdebug_print_raw_mem(vec);
+
+	int multiple[3];
+	v_remove_multiple(vec, &multiple, 1, 3);
+	printf("Removed multiple at [1] :");
+	for (i = 0; i < 3; i++)
+	{
+		printf(" 0x%x", multiple[i]);
+	}
+	printf("\n");
+
+	vdebug_print_info(vec);
+	vdebug_print_raw_mem(vec);
+
+	Vec *top = v_create(sizeof(int));
+	v_top_k(vec, 3, vdebug_cmp_int, top);
+	printf("Top 3 :\n");
+	vdebug_print_raw_mem(top);
+	v_set_size(top, 3);
+	v_add_cfg(top, V_NOAUTOGROW);
+	v_perror("Top 100 into a full vector", v_top_k(vec, 100, vdebug_cmp_int, top));
+	printf("Top 3 kept :\n");
+	vdebug_print_raw_mem(top);
+	v_perror("Merge into a full vector", v_merge(vec, vec, vdebug_cmp_int, top, false));
+	printf("Top 3 kept after merge :\n");
+	vdebug_print_raw_mem(top);
+	v_destroy(top);
+
+	int nth;
+	v_nth_element(vec, 2, vdebug_cmp_int);
+	v_at(vec, &nth, 2);
+	printf("Element [2] if sorted : 0x%x\n", nth);
+
+	vdebug_print_info(vec);
+	vdebug_print_raw_mem(vec);
+
+	Vec *heap = v_clone(vec);
+	v_heap_make(heap, vdebug_cmp_int);
+	v_heap_push(heap, heap->first, vdebug_cmp_int);
+	v_heap_push(heap, heap->first, vdebug_cmp_int);
+	int replaced = 0;
+	v_heap_replace(heap, &replaced, &replaced, vdebug_cmp_int);
+	printf("Replaced top : 0x%x\n", replaced);
+	printf("Heap popped :");
+	while (v_heap_pop(heap, &popped, vdebug_cmp_int) == 0)
+	{
+		printf(" 0x%x", popped);
+	}
+	printf("\n");
+	v_destroy(heap);
+
+	v_partial_sort(vec, v_len(vec), vdebug_cmp_int);
+	Vec *other = v_create(sizeof(int));
+	v_append(other, &appended, 4);
+	Vec *merged = v_create(sizeof(int));
+	v_merge(vec, other, vdebug_cmp_int, merged, true);
+	printf("Merged unique with appended :\n");
+	vdebug_print_info(merged);
+	vdebug_print_raw_mem(merged);
+	v_destroy(merged);
+	v_destroy(other);
+
+	int64_t sum;
+	int32_t min, max;
+	v_sum(vec, VN_INT32, &sum);
+	v_minmax(vec, VN_INT32, &min, &max);
+	printf("Sum : 0x%llx | Min : 0x%x | Max : 0x%x\n", (long long)sum, min, max);
+
+	Vec *big = v_create(sizeof(int64_t));
+	int64_t big_elem = INT64_MAX;
+	for (i = 0; i < 3; i++)
+	{
+		v_push(big, &big_elem);
+	}
+	v_sum(big, VN_INT64, &sum);
+	printf("Wrapped sum of 3 * INT64_MAX : 0x%llx\n", (unsigned long long)sum);
+	v_destroy(big);
+
+	vc_set_thread_count(4);
+	Vec *ones = v_create(sizeof(int32_t));
+	int32_t one = 1;
+	for (i = 0; i < (1 << 19); i++)
+	{
+		v_push(ones, &one);
+	}
+	v_inclusive_scan(ones, VN_INT32, NULL);
+	v_at(ones, &one, (1 << 19) - 1);
+	printf("Last of parallel inclusive scan over 0x80000 ones : 0x%x\n", one);
+	v_destroy(ones);
+
+	uint64_t chained = v_hash_range(vec, 4, v_len(vec), v_hash_range(vec, 0, 4, 0));
+	printf("Hash : 0x%llx | Chained hash : 0x%llx | Chained again equal : %d\n",
+		(unsigned long long)v_hash(vec, 0), (unsigned long long)chained,
+		chained == v_hash_range(vec, 4, v_len(vec), v_hash_range(vec, 0, 4, 0)));
+
+	Vec *perm = v_create(sizeof(size_t));
+	v_argsort(vec, vdebug_cmp_int, perm);
+	size_t *perm_first = perm->first;
+	size_t perm_saved = perm_first[0];
+	perm_first[0] = perm_first[1] | ~(SIZE_MAX >> 1);
+	int perm_err = v_apply_permutation(vec, perm);
+	printf("Invalid permutation rejected : %d | left unchanged : %d\n",
+		perm_err == VE_OUTOFBOUNDS, perm_first[0] == (perm_first[1] | ~(SIZE_MAX >> 1)));
+	perm_first[0] = perm_saved;
+	Vec *sorted = v_clone(vec);
+	v_apply_permutation(sorted, perm);
+	printf("Sorted by argsort :\n");
+	vdebug_print_raw_mem(sorted);
+	v_destroy(sorted);
+	v_destroy(perm);
+
+	Vec *squares = v_create(sizeof(int64_t));
+	size_t visited = 0;
+	ones = v_create(sizeof(int32_t));
+	for (i = 0; i < (1 << 17); i++)
+	{
+		int32_t elem = (int32_t) i;
+		v_push(ones, &elem);
+	}
+	v_parallel_for(ones, vdebug_count_range, &visited, 1000);
+	v_parallel_map(ones, squares, vdebug_square, NULL);
+	int64_t square;
+	v_last(squares, &square);
+	printf("Parallel for visited 0x%zx | Last parallel square : 0x%llx\n",
+		visited, (long long)square);
+	v_destroy(squares);
+	v_destroy(ones);
+
+	Vec *huge = v_create(sizeof(int32_t));
+	v_add_cfg(huge, V_PARALLELCOPY);
+	v_set_size(huge, 3 << 20);
+	for (i = 0; i < (3 << 20); i++)
+	{
+		int32_t elem = (int32_t) i;
+		v_push(huge, &elem);
+	}
+	Vec *huge_clone = v_clone(huge);
+	printf("Parallel clone of 12 MiB equal : %d\n",
+		v_len(huge_clone) == v_len(huge)
+		&& memcmp(huge_clone->first, huge->first, v_len(huge) * sizeof(int32_t)) == 0);
+	v_destroy(huge_clone);
+	v_destroy(huge);
+
 
 
 	VecIter *iter = v_iter(vec);
@@ -213,6 +406,237 @@ int main(void)
 	vi_reset(iter);
 	int next = vi_next(iter, &next);
 	printf("%x\n", next);
+	vi_destroy(iter);
+
+	Vec *collected = vi_collect(vi_take(v_iter_rev(vec), 3));
+	printf("Last 3 in reverse :\n");
+	vdebug_print_info(collected);
+	vdebug_print_raw_mem(collected);
+	v_destroy(collected);
+
+	size_t filter_calls = 0;
+	collected = vi_collect(vi_filter(v_iter(vec), vdebug_is_odd, &filter_calls));
+	printf("Odd elements (%zu filter calls for %zu elements) :\n", filter_calls, v_len(vec));
+	vdebug_print_raw_mem(collected);
+	v_destroy(collected);
+
+	iter = v_iter(vec);
+	v_append(vec, &appended, 4);
+	v_append(vec, &appended, 4);
+	printf("Snapshot after appending :");
+	while (vi_next(iter, &tmp) == 0)
+	{
+		printf(" 0x%x", tmp);
+	}
+	printf("\n");
+	vi_destroy(iter);
+
+	vdebug_print_info(vec);
+	vdebug_print_raw_mem(vec);
+
+	VecIter *parts[4];
+	pthread_t threads[4];
+	iter = v_iter(vec);
+	vi_split_n(iter, 4, parts);
+	vi_destroy(iter);
+	v_push(vec, &test);
+	for (i = 0; i < 4; i++)
+	{
+		pthread_create(&threads[i], NULL, vdebug_destroy_iter, parts[i]);
+	}
+	for (i = 0; i < 4; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	printf("Destroyed 4 split iterators on separate threads\n");
+
+	Vec *filled = v_create(sizeof(int));
+	int fill = 0x7;
+	v_resize_zeroed(filled, 6);
+	v_fill(filled, &fill, 1, 4);
+	printf("Zeroed to 6, filled [1...4] with 0x7 :\n");
+	vdebug_print_info(filled);
+	vdebug_print_raw_mem(filled);
+
+	for (i = 0; i < v_len(filled); i++)
+	{
+		int elem = (int) i;
+		v_fill(filled, &elem, i, i + 1);
+	}
+	v_reverse(filled);
+	printf("Reversed 0...5 :\n");
+	vdebug_print_raw_mem(filled);
+	v_rotate(filled, 2);
+	printf("Rotated left by 2 :\n");
+	vdebug_print_raw_mem(filled);
+	v_swap_ranges(filled, 0, 4, 2);
+	printf("Swapped [0...2] with [4...6] :\n");
+	vdebug_print_raw_mem(filled);
+
+	Vec *set_a = v_clone(filled);
+	Vec *set_b = v_create(sizeof(int));
+	Vec *set_out = v_create(sizeof(int));
+	v_append(set_b, &appended, 4);
+	v_append(set_b, &appended, 4);
+	v_sort_unique(set_a, vdebug_cmp_int);
+	v_sort_unique(set_b, vdebug_cmp_int);
+	printf("Sorted unique :\n");
+	vdebug_print_raw_mem(set_b);
+	v_set_union(set_a, set_b, vdebug_cmp_int, set_out);
+	printf("Union :\n");
+	vdebug_print_raw_mem(set_out);
+	v_set_intersection(set_a, set_b, vdebug_cmp_int, set_out);
+	printf("Intersection :\n");
+	vdebug_print_raw_mem(set_out);
+	v_set_intersection_num(set_a, set_b, VN_INT32, set_out);
+	printf("Numeric intersection :\n");
+	vdebug_print_raw_mem(set_out);
+	v_set_difference(set_a, set_b, vdebug_cmp_int, set_out);
+	printf("Difference :\n");
+	vdebug_print_raw_mem(set_out);
+
+	Vec *parts_to_join[] = {set_a, set_b, set_out};
+	Vec *joined = v_concat(parts_to_join, 3, false);
+	printf("Concatenated :\n");
+	vdebug_print_info(joined);
+	vdebug_print_raw_mem(joined);
+	v_extend_many(joined, parts_to_join, 3, true);
+	printf("Extended by adopting :\n");
+	vdebug_print_info(joined);
+	vdebug_print_raw_mem(joined);
+	v_destroy(set_a);
+	v_destroy(set_b);
+	v_destroy(set_out);
+
+	VecView view = v_view_slice(joined, 2, 10);
+	VecView half = vv_slice(view, 0, 4);
+	int64_t view_sum;
+	int key = 0x4;
+	vv_sum(view, VN_INT32, &view_sum);
+	printf("View [2...10] sum : 0x%llx | [2] : 0x%x | equal to its first half : %d | 0x4 at : %zu\n",
+		(long long)view_sum, *(const int *)vv_at(view, 2), vv_equal(view, half),
+		vv_find(view, &key, vdebug_cmp_int));
+
+	Vec *taken = v_take(joined);
+	v_swap(taken, filled);
+	size_t raw_len;
+	int *raw_elems = v_into_raw(taken, &raw_len);
+	Vec *adopted = v_from_raw(raw_elems, raw_len, raw_len, sizeof(int));
+	printf("Taken len : %zu | swapped len : %zu | adopted from raw :\n",
+		v_len(joined), v_len(filled));
+	vdebug_print_info(adopted);
+	vdebug_print_raw_mem(adopted);
+	v_destroy(adopted);
+	v_destroy(taken);
+
+	const void *span;
+	size_t span_len;
+	int batch[5];
+	iter = v_iter(filled);
+	vi_next_span(iter, 3, &span, &span_len);
+	size_t batch_len = vi_next_n(iter, batch, 5);
+	printf("Span of %zu starting with 0x%x | batch of %zu ending with 0x%x | skipped %zu\n",
+		span_len, *(const int *)span, batch_len, batch[batch_len - 1],
+		vi_next_n(iter, NULL, SIZE_MAX));
+	vi_destroy(iter);
+
+	printf("Range [2...6] :");
+	iter = v_iter_range(filled, 2, 6);
+	while (vi_next(iter, &tmp) == 0)
+	{
+		printf(" 0x%x", tmp);
+	}
+	vi_destroy(iter);
+	printf("\nEvery 5th from [1] :");
+	iter = v_iter_stride(filled, 1, 5);
+	while (vi_next(iter, &tmp) == 0)
+	{
+		printf(" 0x%x", tmp);
+	}
+	vi_destroy(iter);
+	printf("\nReversed :");
+	iter = v_iter_rev(filled);
+	while (vi_next(iter, &tmp) == 0)
+	{
+		printf(" 0x%x", tmp);
+	}
+	vi_destroy(iter);
+	printf("\n");
+
+	VecIter stack_iter;
+	v_iter_init(&stack_iter, filled);
+	v_clear(filled);
+	size_t stack_count = 0;
+	while (vi_next(&stack_iter, &tmp) == 0)
+	{
+		stack_count++;
+	}
+	printf("Stack iterator read %zu elements of its snapshot after clearing | owner : %d\n",
+		stack_count, vi_is_owner(&stack_iter));
+	vi_deinit(&stack_iter);
+
+	Vec *unsorted = v_create(sizeof(int));
+	Vec *unsorted_copy;
+	for (i = 0; i < (1 << 16); i++)
+	{
+		int elem = (int) ((i * 2654435761u) % 100000);
+		v_push(unsorted, &elem);
+	}
+	unsorted_copy = v_clone(unsorted);
+	v_sort_parallel(unsorted, vdebug_cmp_int);
+	v_sort(unsorted_copy, vdebug_cmp_int);
+	printf("Parallel sort of 0x10000 equals v_sort : %d\n", v_equal(unsorted, unsorted_copy));
+	Vec *merged_seq = v_create(sizeof(int));
+	Vec *merged_par = v_create(sizeof(int));
+	v_merge(unsorted, unsorted_copy, vdebug_cmp_int, merged_seq, false);
+	v_merge_parallel(unsorted, unsorted_copy, vdebug_cmp_int, merged_par, false);
+	printf("Parallel merge equals v_merge : %d\n", v_equal(merged_seq, merged_par));
+	v_destroy(merged_par);
+	v_destroy(merged_seq);
+	v_destroy(unsorted_copy);
+	v_destroy(unsorted);
+
+	vc_push_defaults(V_EXACTSIZING, 2);
+	Vec *scoped = v_create(sizeof(int));
+	printf("Scoped default cap : %zu | cfg : 0x%x\n", scoped->cap, (unsigned)scoped->config);
+	v_destroy(scoped);
+	vc_pop_defaults();
+	v_perror("Popping defaults without a scope", vc_pop_defaults());
+	for (i = 0; i < 16; i++)
+	{
+		vc_push_defaults(0, i);
+	}
+	v_perror("Pushing defaults 17 scopes deep", vc_push_defaults(0, 0));
+	for (i = 0; i < 16; i++)
+	{
+		vc_pop_defaults();
+	}
+	scoped = v_create(sizeof(int));
+	printf("Default cap after all scopes : %zu | cfg : 0x%x\n", scoped->cap, (unsigned)scoped->config);
+	v_destroy(scoped);
+
+	Vec *churned = v_create(sizeof(int));
+	int churned_elem = 0x7;
+	void *churned_data;
+	bool churned_stable = true;
+	for (i = 0; i < 3000; i++)
+	{
+		v_prepend(churned, &churned_elem, 1);
+	}
+	churned_data = churned->data;
+	for (i = 0; i < 0x1000; i++)
+	{
+		v_prepend(churned, &churned_elem, 1);
+		v_pop(churned, NULL);
+		v_prepend(churned, &churned_elem, 1);
+		v_remove(churned, NULL, 0);
+		v_insert(churned, &churned_elem, 1);
+		v_remove(churned, NULL, 1);
+		churned_stable = churned_stable && churned->data == churned_data;
+	}
+	printf("Front insertions and removals kept the buffer : %d | cap : %zu\n",
+		churned_stable, churned->cap);
+	v_destroy(churned);
 
 	return 0;
 }
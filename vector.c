@@ -6,6 +6,13 @@
 #include <string.h>
 #include <time.h>
 
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "vector.h"
 
 
@@ -29,17 +36,61 @@ struct vinternal_Vec
 	void *first, *last;
 	size_t offset;
 
-	uint8_t config; // last bit stores ownage - move to bool? wouldn't impact struct size
+	struct vinternal_Shared *shared;
+
+	uint16_t config; // last bit stores ownage - move to bool? wouldn't impact struct size
 };
 
 /**
- * Internal iterator struct.
- * Opaque to user.
+ * Buffer shared between a vector and the snapshots taken of it
+ * by its iterators. Whoever drops the last reference frees it.
+ * refs is only changed atomically.
+ */
+struct vinternal_Shared
+{
+	void *data;
+	size_t cap;
+	size_t refs;
+};
+
+/**
+ * Kinds of lazy iterator adaptors.
+ */
+enum vinternal_IterKind
+{
+	VINTERNAL_ITER_MAP,
+	VINTERNAL_ITER_FILTER,
+	VINTERNAL_ITER_TAKE,
+	VINTERNAL_ITER_ZIP,
+	VINTERNAL_ITER_CHAIN,
+};
+
+/**
+ * State of an iterator adaptor pulling chunks from its source
+ * iterators. Chunks are passed through as they are where possible,
+ * otherwise they are produced into buf in batches.
  */
-struct vinternal_VecIter
+struct vinternal_IterAdaptor
 {
-	Vec *vec;
-	void *finger;
+	enum vinternal_IterKind kind;
+
+	VecIter *src[2];
+
+	// chunks pulled from the sources but not consumed yet
+	const char *in[2];
+	size_t in_count[2];
+
+	// chunk produced but not handed out yet
+	const char *out;
+	size_t out_count;
+
+	VecMapFn map;
+	VecFilterFn filter;
+	void *ctx;
+
+	size_t limit, left;
+
+	char *buf;
 };
 
 /**
@@ -61,10 +112,35 @@ static const char *const VINTERNAL_ERROR_STRINGS[] =
 
 static const size_t VINTERNAL_HALF_SIZE_MAX = (~((size_t) 0)) >> 1; // use SIZE_MAX from limits.h?
 
-static const uint8_t VINTERNAL_OWNAGE_MASK = 1 << 7;
+static const uint16_t VINTERNAL_OWNAGE_MASK = 1 << 15;
 
 
-static uint8_t vinternal_base_cfg = VC_DEFAULT_BASE_CFG;
+/**
+ * Global defaults may be changed by any thread at any time,
+ * so they are only accessed through VMACRO_LOAD and VMACRO_STORE.
+ * Reference counts of shared buffers are only changed through
+ * VMACRO_REF_INC and VMACRO_REF_DEC, since iterators sharing a
+ * buffer may be destroyed on different threads.
+ * Without GCC style atomics and thread-local storage, accesses
+ * are plain and all threads share the override stack.
+ */
+#if defined(__GNUC__)
+#define VMACRO_LOAD(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#define VMACRO_STORE(var, val) __atomic_store_n(&(var), (val), __ATOMIC_RELAXED)
+#define VMACRO_REF_LOAD(var) __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define VMACRO_REF_INC(var) __atomic_fetch_add(&(var), 1, __ATOMIC_ACQ_REL)
+#define VMACRO_REF_DEC(var) __atomic_sub_fetch(&(var), 1, __ATOMIC_ACQ_REL)
+#define VINTERNAL_THREAD_LOCAL __thread
+#else
+#define VMACRO_LOAD(var) (var)
+#define VMACRO_STORE(var, val) ((var) = (val))
+#define VMACRO_REF_LOAD(var) (var)
+#define VMACRO_REF_INC(var) ((var)++)
+#define VMACRO_REF_DEC(var) (--(var))
+#define VINTERNAL_THREAD_LOCAL
+#endif
+
+static uint16_t vinternal_base_cfg = VC_DEFAULT_BASE_CFG;
 
 static size_t vinternal_base_cap = VC_DEFAULT_BASE_CAP;
 
@@ -72,6 +148,26 @@ static size_t vinternal_base_cap = VC_DEFAULT_BASE_CAP;
 static FILE *vinternal_out_stream = NULL;
 static FILE *vinternal_err_stream = NULL;
 
+// thread count of the pool, 0 to use one thread per online CPU
+static size_t vinternal_thread_count = 0;
+
+
+/**
+ * Maximum amount of nested vc_push_defaults scopes per thread.
+ */
+#define VINTERNAL_DEFAULTS_DEPTH 16
+
+/**
+ * Per thread stack of defaults overriding the global ones.
+ */
+static VINTERNAL_THREAD_LOCAL struct
+{
+	uint16_t cfg;
+	size_t cap;
+} vinternal_defaults[VINTERNAL_DEFAULTS_DEPTH];
+
+static VINTERNAL_THREAD_LOCAL size_t vinternal_defaults_depth = 0;
+
 
 /**
  * Return int from caller if the retval of func is non-zero.
@@ -131,6 +227,16 @@ bool vinternal_c_keepoffset(Vec *vec)
 {
 	return (vec->config & V_KEEPOFFSET);
 }
+static inline
+bool vinternal_c_quadheap(Vec *vec)
+{
+	return (vec->config & V_QUADHEAP);
+}
+static inline
+bool vinternal_c_parallelcopy(Vec *vec)
+{
+	return (vec->config & V_PARALLELCOPY);
+}
 
 static inline
 bool vinternal_owned(Vec *vec)
@@ -139,6 +245,386 @@ bool vinternal_owned(Vec *vec)
 }
 
 
+/**
+ * Get the defaults of newly created vectors, preferring
+ * the innermost override scope of the calling thread.
+ */
+static inline
+uint16_t vinternal_get_base_cfg(void)
+{
+	if (vinternal_defaults_depth > 0)
+		return vinternal_defaults[vinternal_defaults_depth - 1].cfg;
+
+	return VMACRO_LOAD(vinternal_base_cfg);
+}
+static inline
+size_t vinternal_get_base_cap(void)
+{
+	if (vinternal_defaults_depth > 0)
+		return vinternal_defaults[vinternal_defaults_depth - 1].cap;
+
+	return VMACRO_LOAD(vinternal_base_cap);
+}
+
+/**
+ * Get the streams to log to.
+ */
+static inline
+FILE *vinternal_get_out_stream(void)
+{
+	FILE *stream = VMACRO_LOAD(vinternal_out_stream);
+
+	return stream ? stream : stdout;
+}
+static inline
+FILE *vinternal_get_err_stream(void)
+{
+	FILE *stream = VMACRO_LOAD(vinternal_err_stream);
+
+	return stream ? stream : stderr;
+}
+
+
+/**
+ * A job of the thread pool, split into chunk_count chunks that
+ * are processed by run in any order and on any thread.
+ */
+struct vinternal_Job
+{
+	void (*run)(void *ctx, size_t chunk);
+	void *ctx;
+
+	size_t chunk_count;
+	size_t next_chunk, pending;
+};
+
+/**
+ * Thread pool shared by all parallel functions, started on first use.
+ * Idle workers and the thread submitting a job take its chunks one
+ * after another, so faster threads simply end up processing more of
+ * them. Only one job runs at a time, jobs submitted while the pool is
+ * busy (e.g. from inside of a running job) run on the calling thread.
+ */
+static struct
+{
+	pthread_mutex_t lock;
+	pthread_cond_t wake, done;
+
+	pthread_t *workers;
+	size_t worker_count;
+	bool started, stop;
+
+	struct vinternal_Job *job;
+} vinternal_pool =
+{
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER,
+};
+
+/**
+ * Size in bytes of the ranges parallel functions hand to one thread
+ * at once if no grain is given. Small enough for a range to stay in
+ * the L2 cache, large enough to make scheduling overhead negligible.
+ */
+static const size_t VINTERNAL_PARALLEL_CHUNK = 1 << 16;
+
+/**
+ * Amount of threads the pool should use, including the submitting one.
+ */
+static
+size_t vinternal_threads(void)
+{
+	size_t count = VMACRO_LOAD(vinternal_thread_count);
+
+	if (count > 0)
+		return count;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (cpus > 0)
+		return (size_t) cpus;
+#endif
+
+	return 1;
+}
+
+/**
+ * Take and process chunks of the current job until none are left.
+ * Has to be called with the pool lock held.
+ */
+static
+void vinternal_pool_work(struct vinternal_Job *job)
+{
+	while (job->next_chunk < job->chunk_count)
+	{
+		size_t chunk = job->next_chunk++;
+
+		pthread_mutex_unlock(&vinternal_pool.lock);
+		job->run(job->ctx, chunk);
+		pthread_mutex_lock(&vinternal_pool.lock);
+
+		if (--job->pending == 0)
+			pthread_cond_broadcast(&vinternal_pool.done);
+	}
+}
+
+static
+void *vinternal_pool_worker(void *arg)
+{
+	(void) arg;
+
+	pthread_mutex_lock(&vinternal_pool.lock);
+
+	for (;;)
+	{
+		while (!vinternal_pool.stop && (vinternal_pool.job == NULL
+			|| vinternal_pool.job->next_chunk == vinternal_pool.job->chunk_count))
+		{
+			pthread_cond_wait(&vinternal_pool.wake, &vinternal_pool.lock);
+		}
+
+		if (vinternal_pool.stop)
+			break;
+
+		vinternal_pool_work(vinternal_pool.job);
+	}
+
+	pthread_mutex_unlock(&vinternal_pool.lock);
+
+	return NULL;
+}
+
+/**
+ * Start the workers of the pool. Has to be called with the pool
+ * lock held. If not all of them can be started, the pool works
+ * with fewer threads.
+ */
+static
+void vinternal_pool_start(void)
+{
+	size_t count = vinternal_threads() - 1;
+
+	vinternal_pool.started = true;
+	vinternal_pool.stop = false;
+	vinternal_pool.worker_count = 0;
+	vinternal_pool.workers = (count > 0) ? malloc(count * sizeof(pthread_t)) : NULL;
+
+	if (vinternal_pool.workers == NULL)
+		return;
+
+	while (vinternal_pool.worker_count < count
+		&& pthread_create(&vinternal_pool.workers[vinternal_pool.worker_count],
+			NULL, vinternal_pool_worker, NULL) == 0)
+	{
+		vinternal_pool.worker_count++;
+	}
+}
+
+/**
+ * Stop and join all workers of the pool.
+ */
+static
+void vinternal_pool_stop(void)
+{
+	pthread_mutex_lock(&vinternal_pool.lock);
+
+	if (!vinternal_pool.started)
+	{
+		pthread_mutex_unlock(&vinternal_pool.lock);
+		return;
+	}
+
+	vinternal_pool.stop = true;
+	pthread_cond_broadcast(&vinternal_pool.wake);
+
+	pthread_mutex_unlock(&vinternal_pool.lock);
+
+	for (size_t i = 0; i < vinternal_pool.worker_count; i++)
+		pthread_join(vinternal_pool.workers[i], NULL);
+
+	pthread_mutex_lock(&vinternal_pool.lock);
+
+	free(vinternal_pool.workers);
+
+	vinternal_pool.workers = NULL;
+	vinternal_pool.worker_count = 0;
+	vinternal_pool.started = false;
+	vinternal_pool.stop = false;
+
+	pthread_mutex_unlock(&vinternal_pool.lock);
+}
+
+/**
+ * Process chunk_count chunks with run, spread over the thread pool.
+ * Returns once all of them have been processed.
+ */
+static
+void vinternal_parallel_run(void (*run)(void *ctx, size_t chunk), void *ctx, size_t chunk_count)
+{
+	if (chunk_count > 1 && vinternal_threads() > 1)
+	{
+		pthread_mutex_lock(&vinternal_pool.lock);
+
+		if (vinternal_pool.job == NULL)
+		{
+			if (!vinternal_pool.started)
+				vinternal_pool_start();
+
+			struct vinternal_Job job =
+			{
+				.run = run,
+				.ctx = ctx,
+				.chunk_count = chunk_count,
+				.next_chunk = 0,
+				.pending = chunk_count,
+			};
+
+			vinternal_pool.job = &job;
+			pthread_cond_broadcast(&vinternal_pool.wake);
+
+			vinternal_pool_work(&job);
+
+			while (job.pending > 0)
+				pthread_cond_wait(&vinternal_pool.done, &vinternal_pool.lock);
+
+			vinternal_pool.job = NULL;
+
+			pthread_mutex_unlock(&vinternal_pool.lock);
+
+			return;
+		}
+
+		pthread_mutex_unlock(&vinternal_pool.lock);
+	}
+
+	for (size_t chunk = 0; chunk < chunk_count; chunk++)
+		run(ctx, chunk);
+}
+
+/**
+ * Amount of elements per chunk of a parallel function,
+ * derived from the size of the elements if grain is 0.
+ */
+static inline
+size_t vinternal_grain(size_t grain, size_t elem_size)
+{
+	if (grain > 0)
+		return grain;
+
+	grain = VINTERNAL_PARALLEL_CHUNK / elem_size;
+
+	return (grain > 0) ? grain : 1;
+}
+
+/**
+ * Amount of chunks of grain elements len elements are split into.
+ */
+static inline
+size_t vinternal_chunk_count(size_t len, size_t grain)
+{
+	return (len / grain) + ((len % grain) ? 1 : 0);
+}
+
+/**
+ * Copies of at least this many bytes are split over the thread
+ * pool for vectors with V_PARALLELCOPY, in pieces of the chunk size.
+ * Below it, a single memcpy stays in cache and is faster.
+ */
+static const size_t VINTERNAL_PARALLEL_COPY_MIN = 1 << 23;
+static const size_t VINTERNAL_PARALLEL_COPY_CHUNK = 1 << 20;
+
+/**
+ * Copy bytes without pulling the destination into the cache,
+ * if the architecture supports non-temporal stores.
+ */
+static
+void vinternal_stream_copy(char *dest, const char *src, size_t bytes)
+{
+#if defined(__SSE2__)
+	size_t head = (16 - ((uintptr_t) dest & 15)) & 15;
+
+	if (head > bytes)
+		head = bytes;
+
+	memcpy(dest, src, head);
+
+	dest += head;
+	src += head;
+	bytes -= head;
+
+	for (; bytes >= 64; bytes -= 64, dest += 64, src += 64)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *) src);
+		__m128i b = _mm_loadu_si128((const __m128i *) (src + 16));
+		__m128i c = _mm_loadu_si128((const __m128i *) (src + 32));
+		__m128i d = _mm_loadu_si128((const __m128i *) (src + 48));
+
+		_mm_stream_si128((__m128i *) dest, a);
+		_mm_stream_si128((__m128i *) (dest + 16), b);
+		_mm_stream_si128((__m128i *) (dest + 32), c);
+		_mm_stream_si128((__m128i *) (dest + 48), d);
+	}
+
+	_mm_sfence();
+#endif
+
+	memcpy(dest, src, bytes);
+}
+
+/**
+ * Context of a parallel bulk copy.
+ */
+struct vinternal_CopyCtx
+{
+	char *dest;
+	const char *src;
+	size_t bytes;
+};
+
+static
+void vinternal_copy_chunk(void *raw, size_t chunk)
+{
+	struct vinternal_CopyCtx *ctx = raw;
+
+	size_t from = chunk * VINTERNAL_PARALLEL_COPY_CHUNK;
+	size_t bytes = (ctx->bytes - from < VINTERNAL_PARALLEL_COPY_CHUNK)
+		? ctx->bytes - from
+		: VINTERNAL_PARALLEL_COPY_CHUNK;
+
+	vinternal_stream_copy(ctx->dest + from, ctx->src + from, bytes);
+}
+
+/**
+ * Copy a large block of elements between non-overlapping buffers.
+ * If parallel is set and the block is large enough, the copy is
+ * split over the thread pool and bypasses the cache.
+ */
+static
+void vinternal_bulk_copy(void *dest, const void *src, size_t bytes, bool parallel)
+{
+	if (bytes == 0)
+		return;
+
+	if (!parallel || bytes < VINTERNAL_PARALLEL_COPY_MIN)
+	{
+		memcpy(dest, src, bytes);
+		return;
+	}
+
+	struct vinternal_CopyCtx ctx =
+	{
+		.dest = dest,
+		.src = src,
+		.bytes = bytes,
+	};
+
+	vinternal_parallel_run(vinternal_copy_chunk, &ctx,
+		vinternal_chunk_count(bytes, VINTERNAL_PARALLEL_COPY_CHUNK));
+}
+
+
 /**
  * Overflow checked double operation on size_t.
  */
@@ -175,7 +661,7 @@ size_t vinternal_size_t_add(size_t x, size_t y)
 static inline
 size_t vinternal_size_t_sub(size_t x, size_t y)
 {
-	return x > y
+	return x < y
 		? 0
 		: x - y;
 }
@@ -226,7 +712,9 @@ Vec *vinternal_create(size_t elem_size, size_t base_cap)
 
 	vec->offset = 0;
 
-	vec->config = vinternal_base_cfg;
+	vec->shared = NULL;
+
+	vec->config = vinternal_get_base_cfg();
 
 	return vec;
 }
@@ -247,10 +735,13 @@ Vec *vinternal_clone(Vec *vec, size_t from, size_t to, bool reduced)
 	clone->len = clone_len;
 	clone->offset = reduced ? 0 : vec->offset;
 
-	clone->first = memcpy(
-		((char *) clone->data) + (clone->offset * clone->elem_size),
+	clone->first = ((char *) clone->data) + (clone->offset * clone->elem_size);
+
+	vinternal_bulk_copy(
+		clone->first,
 		((char *) vec->first) + (from * vec->elem_size),
-		clone_len * vec->elem_size);
+		clone_len * vec->elem_size,
+		vinternal_c_parallelcopy(vec));
 
 	clone->last = ((char *) clone->first) + (clone->len * clone->elem_size);
 
@@ -258,54 +749,148 @@ Vec *vinternal_clone(Vec *vec, size_t from, size_t to, bool reduced)
 }
 
 /**
- * Zeroes the offset of a vector only if that is
- * enough to reach min_cap and config allows it.
- * Returns true if offset has been zeroed.
+ * Leave a vector empty and without a buffer
+ * after its buffer has been handed off.
  */
-static inline // now included in vinternal_set_size
-bool vinternal_zero_offset_maybe(Vec *vec, size_t min_cap)
+static inline
+void vinternal_release(Vec *vec)
 {
-	if (vec->cap < min_cap || vec->offset == 0)
-		return false;
+	vec->data = vec->first = vec->last = NULL;
+	vec->cap = vec->len = vec->offset = 0;
+	vec->shared = NULL;
+}
 
-	if (vec->cap - vec->offset < min_cap && !vinternal_c_keepoffset(vec))
+/**
+ * Drop a reference to a shared buffer,
+ * freeing it if it was the last one.
+ */
+static inline
+void vinternal_shared_release(struct vinternal_Shared *shared)
+{
+	if (VMACRO_REF_DEC(shared->refs) == 0)
 	{
-		memmove(
-			vec->data,
-			vec->first,
-			vec->len * vec->elem_size);
-
-		vec->offset = 0;
-
-		return true;
+		free(shared->data);
+		free(shared);
 	}
-
-	return false;
 }
+
 /**
- * Resize a vector to size if possible and respecting its config.
+ * Give the buffer of a vector its own copy if it is
+ * shared with snapshots, before the vector modifies it.
  */
 static
-int vinternal_set_size(Vec *vec, size_t size, bool keep_offset, bool prefer_memmove) // TODO: offset handling
+int vinternal_unshare(Vec *vec)
 {
-	if (size == 0)
-	{
-		v_clear(vec);
+	struct vinternal_Shared *shared = vec->shared;
+
+	if (shared == NULL)
 		return VE_OK;
-	}
 
-	if (vec->cap == 0)
+	// only the vector itself adds references, so once it holds
+	// the last one no other thread can share the buffer again
+	if (VMACRO_REF_LOAD(shared->refs) > 1)
 	{
-		void *data = malloc(size * vec->elem_size);
+		char *data = malloc(vec->cap * vec->elem_size);
 
 		if (data == NULL)
 			return VE_NOMEM;
 
 		vec->data = data;
+		vec->first = memcpy(
+			data + (vec->offset * vec->elem_size),
+			vec->first,
+			vec->len * vec->elem_size);
+		vec->last = ((char *) vec->first) + (vec->len * vec->elem_size);
+
+		// the snapshots may have been dropped in the meantime
+		vinternal_shared_release(shared);
+	}
+	else
+	{
+		free(shared);
+	}
+
+	vec->shared = NULL;
+
+	return VE_OK;
+}
+
+/**
+ * Drop the reference of a vector to a shared buffer without
+ * copying it, leaving the vector without a buffer.
+ * Returns false if the buffer of the vector is not shared.
+ */
+static
+bool vinternal_drop_shared(Vec *vec)
+{
+	struct vinternal_Shared *shared = vec->shared;
+
+	if (shared == NULL)
+		return false;
+
+	vinternal_shared_release(shared);
+
+	vinternal_release(vec);
+
+	return true;
+}
+
+/**
+ * Zeroes the offset of a vector only if that is
+ * enough to reach min_cap.
+ * Returns true if offset has been zeroed.
+ */
+static inline
+bool vinternal_zero_offset_maybe(Vec *vec, size_t min_cap)
+{
+	if (vec->cap < min_cap || vec->offset == 0)
+		return false;
+
+	if (vec->cap - vec->offset < min_cap)
+	{
+		vec->first = memmove(
+			vec->data,
+			vec->first,
+			vec->len * vec->elem_size);
+
+		vec->last = ((char *) vec->first) + (vec->len * vec->elem_size);
+
+		vec->offset = 0;
+
+		return true;
+	}
+
+	return false;
+}
+/**
+ * Resize a vector so that size elements fit behind its offset
+ * if keep_offset is set, otherwise move its elements to the
+ * start of a buffer of size elements.
+ * If prefer_memmove is set and the current buffer is already
+ * large enough, the elements are moved inside of it instead.
+ */
+static
+int vinternal_set_size(Vec *vec, size_t size, bool keep_offset, bool prefer_memmove)
+{
+	if (size == 0 && (vec->offset == 0 || !keep_offset))
+	{
+		v_clear(vec);
+		return VE_OK;
+	}
+
+	if (vec->cap == 0)
+	{
+		void *data = malloc(size * vec->elem_size);
+
+		if (data == NULL)
+			return VE_NOMEM;
+
+		vec->data = data;
+		vec->offset = 0;
 	}
 	else if (vec->offset == 0 || keep_offset)
 	{
-		if (vinternal_real_cap(vec) == size)
+		if (vec->cap == size + vec->offset)
 			return VE_OK;
 
 		void *new_data = realloc(vec->data, (size + vec->offset) * vec->elem_size);
@@ -315,14 +900,10 @@ int vinternal_set_size(Vec *vec, size_t size, bool keep_offset, bool prefer_memm
 
 		vec->data = new_data;
 	}
-	else if (vec->cap >= size && prefer_memmove) // ???
+	else if (vec->cap >= size && prefer_memmove)
 	{
-		vec->offset = vec->cap - size;
-
-		vec->first = memmove(
-			((char *) vec->data) + (vec->offset * vec->elem_size),
-			vec->first,
-			vec->len);
+		vinternal_zero_offset_maybe(vec, vec->cap);
+		return VE_OK;
 	}
 	else
 	{
@@ -331,10 +912,11 @@ int vinternal_set_size(Vec *vec, size_t size, bool keep_offset, bool prefer_memm
 		if (new_data == NULL)
 			return VE_NOMEM;
 
-		memcpy(
+		vinternal_bulk_copy(
 			new_data,
-			((char *) vec->data) + (vec->offset * vec->elem_size),
-			vec->len * vec->elem_size);
+			vec->first,
+			vec->len * vec->elem_size,
+			vinternal_c_parallelcopy(vec));
 
 		free(vec->data);
 
@@ -345,46 +927,146 @@ int vinternal_set_size(Vec *vec, size_t size, bool keep_offset, bool prefer_memm
 	vec->first = ((char *) vec->data) + (vec->offset * vec->elem_size);
 	vec->last = ((char *) vec->first) + (vec->len * vec->elem_size);
 
-	vec->cap = size;
+	vec->cap = size + vec->offset;
 
 	return VE_OK;
 }
 /**
  * Grows the vector to the required capacity
  * if config allows it.
+ * Moving the elements to the start of the buffer
+ * does not count as growing.
  */
 static inline
 int vinternal_grow_maybe(Vec *vec, size_t min_cap, bool keep_offset)
 {
+	if (vec->cap - vec->offset >= min_cap)
+		return VE_OK;
+
+	if (!keep_offset && vinternal_zero_offset_maybe(vec, min_cap))
+		return VE_OK;
+
 	size_t new_cap, real_cap;
-	new_cap = real_cap = vinternal_real_cap(vec);
+	new_cap = real_cap = keep_offset
+		? vec->cap - vec->offset
+		: vec->cap;
 
 	while (min_cap > new_cap)
 		new_cap = vinternal_size_t_double(new_cap);
 
-	if (new_cap == real_cap)
-		return VE_OK;
-
 	if (vinternal_c_noautogrow(vec))
 		return VE_NOCAP;
 
 	VMACRO_RETURN_MAYBE(
-		vinternal_set_size(vec, new_cap, keep_offset, true));
+		vinternal_set_size(vec, new_cap, keep_offset, false));
+
+	return VE_OK;
+}
+/**
+ * Moves the elements into a new buffer of size elements,
+ * offset elements after its start.
+ * Size and offset are unchecked!
+ */
+static
+int vinternal_move_to_buffer(Vec *vec, size_t size, size_t offset)
+{
+	if (size > ((size_t) SIZE_MAX) / vec->elem_size)
+		return VE_NOMEM;
+
+	void *new_data = malloc(size * vec->elem_size);
+
+	if (new_data == NULL)
+		return VE_NOMEM;
+
+	size_t offset_size = offset * vec->elem_size;
+
+	vinternal_bulk_copy(
+		((char *) new_data) + offset_size,
+		vec->first,
+		vec->len * vec->elem_size,
+		vinternal_c_parallelcopy(vec));
+
+	free(vec->data);
+
+	vec->data = new_data;
+	vec->first = ((char *) vec->data) + offset_size;
+	vec->last = ((char *) vec->first) + (vec->len * vec->elem_size);
+
+	vec->cap = size;
+	vec->offset = offset;
+
+	return VE_OK;
+}
+/**
+ * Makes room for amount elements in front of the vector.
+ * If the offset is too small, the elements get centered in
+ * a buffer with at least as much free space as they occupy,
+ * so that both prepends and appends are amortized O(1).
+ * The current buffer is reused if it is large enough,
+ * otherwise it is grown if config allows it.
+ */
+static
+int vinternal_grow_front_maybe(Vec *vec, size_t amount)
+{
+	if (vec->offset >= amount)
+		return VE_OK;
+
+	size_t min_cap = vinternal_size_t_add(vec->len, amount);
+	size_t new_cap = vec->cap;
+
+	if ((new_cap >> 1) < min_cap)
+	{
+		if (vinternal_c_noautogrow(vec))
+		{
+			if (new_cap < min_cap)
+				return VE_NOCAP;
+		}
+		else
+		{
+			while ((new_cap >> 1) < min_cap && new_cap != (size_t) SIZE_MAX)
+				new_cap = vinternal_size_t_double(new_cap);
+		}
+	}
+
+	size_t new_offset = amount + ((new_cap - min_cap) >> 1);
+	size_t new_offset_size = new_offset * vec->elem_size;
+
+	if (new_cap == vec->cap)
+	{
+		vec->first = memmove(
+			((char *) vec->data) + new_offset_size,
+			vec->first,
+			vec->len * vec->elem_size);
+	}
+	else
+	{
+		return vinternal_move_to_buffer(vec, new_cap, new_offset);
+	}
+
+	vec->offset = new_offset;
+	vec->last = ((char *) vec->first) + (vec->len * vec->elem_size);
 
 	return VE_OK;
 }
 /**
  * Shrinks the vector if it makes sense
  * and config allows it.
+ * It only shrinks once at most a quarter of the capacity is
+ * used and leaves at least twice the length, so growing
+ * never has to be undone right away by the next removal.
+ * Unless V_KEEPOFFSET is set, the space in front of the
+ * elements counts as capacity, and a vector that had some
+ * keeps it by being centered in the smaller buffer, so that
+ * front insertions do not have to move everything again.
  */
 static inline
-int vinternal_shrink_maybe(Vec *vec) // TODO: account for offset in loop?
+int vinternal_shrink_maybe(Vec *vec)
 {
-	size_t half_cap, new_cap, real_cap;
-	half_cap = new_cap = real_cap = vinternal_real_cap(vec);
+	size_t new_cap, real_cap;
+	new_cap = real_cap = vinternal_real_cap(vec);
 
-	while (vec->len <= (half_cap >>= 1))
-		new_cap = half_cap;
+	while (new_cap > 0 && vec->len <= (new_cap >> 2))
+		new_cap >>= 1;
 
 	if (new_cap == real_cap)
 		return VE_OK;
@@ -392,113 +1074,2464 @@ int vinternal_shrink_maybe(Vec *vec) // TODO: account for offset in loop?
 	if (vinternal_c_noautoshrink(vec))
 		return VE_OK;
 
+	bool keep_offset = vinternal_c_keepoffset(vec);
+
+	if (!keep_offset && vec->offset > 0 && new_cap > 0)
+		return vinternal_move_to_buffer(vec, new_cap, (new_cap - vec->len) >> 1);
+
 	VMACRO_RETURN_MAYBE(
-		vinternal_set_size(vec, new_cap, vinternal_c_keepoffset(vec), false));
+		vinternal_set_size(vec, new_cap, keep_offset, false));
 
 	return VE_OK;
 }
 
 /**
- * General logging function with timestamp.
+ * Opens a gap of amount elements at index by shifting
+ * whichever side of the index is shorter.
+ * Room in front of the vector is made the same way
+ * as for prepends. Index is unchecked!
  */
-VMACRO_VERBOSE_MODE(
 static
-void vinternal_log_to_stream(FILE *stream, char *tag, char *msg)
+int vinternal_open_gap(Vec *vec, size_t index, size_t amount)
 {
-	time_t current_time_raw = time(NULL);
-	struct tm *current_time = localtime(&current_time_raw);
-	fprintf(stream, "[%d-%d-%d %d:%d:%d] [%s] : %s\n",
-		current_time->tm_year,
-		current_time->tm_mon,
-		current_time->tm_mday,
+	size_t shift_size = amount * vec->elem_size;
+	bool shift_front = (index < vec->len - index);
 
-		current_time->tm_hour,
-		current_time->tm_min,
-		current_time->tm_sec,
+	if (shift_front && vec->offset < amount)
+	{
+		VMACRO_RETURN_MAYBE(
+			vinternal_grow_front_maybe(vec, amount));
+	}
 
-		tag, msg);
-})
+	if (shift_front)
+	{
+		vec->first = memmove(
+			((char *) vec->first) - shift_size,
+			vec->first,
+			index * vec->elem_size);
+
+		vec->offset -= amount;
+	}
+	else
+	{
+		VMACRO_RETURN_MAYBE(
+			vinternal_grow_maybe(vec, vec->len + amount, vinternal_c_keepoffset(vec)));
+
+		memmove(
+			((char *) vec->first) + ((index + amount) * vec->elem_size),
+			((char *) vec->first) + (index * vec->elem_size),
+			(vec->len - index) * vec->elem_size);
+	}
+
+	vec->len += amount;
+	vec->last = ((char *) vec->first) + (vec->len * vec->elem_size);
+
+	return VE_OK;
+}
 /**
- * Log to vinternal_out_stream.
- * Only logs in verbose mode.
+ * Closes a gap of amount elements at index by shifting
+ * whichever side of the gap is shorter.
+ * Index and amount are unchecked!
  */
-VMACRO_VERBOSE_MODE(
-static inline
-void vinternal_log(char *tag, char *msg)
+static
+void vinternal_close_gap(Vec *vec, size_t index, size_t amount)
 {
-	vinternal_log_to_stream(
-		vinternal_out_stream
-		? vinternal_out_stream
-		: stdout,
-		tag, msg);
-})
+	size_t tail_len = vec->len - index - amount;
+
+	if (index < tail_len)
+	{
+		vec->first = memmove(
+			((char *) vec->first) + (amount * vec->elem_size),
+			vec->first,
+			index * vec->elem_size);
+
+		vec->offset += amount;
+	}
+	else
+	{
+		memmove(
+			((char *) vec->first) + (index * vec->elem_size),
+			((char *) vec->first) + ((index + amount) * vec->elem_size),
+			tail_len * vec->elem_size);
+	}
+
+	vec->len -= amount;
+	vec->last = ((char *) vec->first) + (vec->len * vec->elem_size);
+}
+
 /**
- * Log to vinternal_err_stream.
- * Only logs in verbose mode.
+ * Swap two elements of the specified size.
+ * Common element sizes are swapped through registers.
  */
-VMACRO_VERBOSE_MODE(
 static inline
-void vinternal_err(char *tag, char *msg)
+void vinternal_swap(void *a, void *b, size_t size)
 {
-	vinternal_log_to_stream(
-		vinternal_err_stream
-		? vinternal_err_stream
-		: stderr,
-		tag, msg);
-})
+	switch (size)
+	{
+		case 4:
+		{
+			uint32_t tmp;
+			memcpy(&tmp, a, 4);
+			memcpy(a, b, 4);
+			memcpy(b, &tmp, 4);
+			return;
+		}
+		case 8:
+		{
+			uint64_t tmp;
+			memcpy(&tmp, a, 8);
+			memcpy(a, b, 8);
+			memcpy(b, &tmp, 8);
+			return;
+		}
+		default:
+			break;
+	}
 
+	unsigned char buf[64];
+	unsigned char *x = a, *y = b;
 
-// Implementations functions exposed to user ; doc in vector.h
+	while (size > 0)
+	{
+		size_t chunk = size < sizeof(buf) ? size : sizeof(buf);
 
-void vc_set_base_cfg(enum VecCfg config)
-{
-	vinternal_base_cfg = config & ~VINTERNAL_OWNAGE_MASK;
-}
+		memcpy(buf, x, chunk);
+		memcpy(x, y, chunk);
+		memcpy(y, buf, chunk);
 
-void vc_set_base_cap(size_t base_cap)
-{
-	vinternal_base_cap = base_cap;
+		x += chunk;
+		y += chunk;
+		size -= chunk;
+	}
 }
 
-void vc_set_output_stream(FILE *stream)
+/**
+ * Compare two elements, optionally with reversed order.
+ */
+static inline
+int vinternal_cmp(const void *a, const void *b, VecCmp cmp, bool reverse)
 {
-	vinternal_out_stream = stream;
+	return reverse ? cmp(b, a) : cmp(a, b);
 }
 
-void vc_set_error_stream(FILE *stream)
+/**
+ * Maximum recursion depth of introsort/introselect
+ * before falling back to heap based algorithms.
+ */
+static inline
+size_t vinternal_depth_limit(size_t len)
 {
-	vinternal_err_stream = stream;
+	size_t depth = 0;
+
+	while (len >>= 1)
+		depth += 2;
+
+	return depth;
 }
 
+/**
+ * Ranges of up to this many elements are
+ * finished with an insertion sort.
+ */
+static const size_t VINTERNAL_SMALL_SORT = 16;
 
-void v_perror(const char *str, enum VecErr err)
+/**
+ * Insertion sort on a small range.
+ */
+static
+void vinternal_insertion_sort(char *base, size_t len, size_t size, VecCmp cmp)
 {
-	const char *colon;
-
-	if (str == NULL || *str == '\0')
-		str = colon = "";
-	else
-		colon = ": ";
+	for (size_t i = 1; i < len; i++)
+	{
+		for (size_t j = i; j > 0; j--)
+		{
+			char *cur = base + (j * size);
 
-	if (err < 0 || err >= VINTERNAL_LAST)
-		err = VINTERNAL_LAST;
+			if (cmp(cur - size, cur) <= 0)
+				break;
 
-	fprintf(
-		vinternal_err_stream ? vinternal_err_stream : stderr,
-		"%s%s%s\n",
-		str, colon, VINTERNAL_ERROR_STRINGS[err]);
+			vinternal_swap(cur - size, cur, size);
+		}
+	}
 }
 
-
-Vec *v_create(size_t elem_size)
+/**
+ * Restore the heap property below root.
+ * The heap is a max heap regarding cmp,
+ * a min heap if reverse is set.
+ */
+static
+void vinternal_sift_down(char *base, size_t root, size_t len, size_t size, VecCmp cmp, bool reverse)
 {
-	return vinternal_create(elem_size, vinternal_base_cap);
-}
+	for (;;)
+	{
+		size_t child = (root << 1) + 1;
 
-Vec *v_create_with(size_t elem_size, size_t base_cap)
-{
-	return vinternal_create(elem_size, base_cap);
-}
+		if (child >= len)
+			return;
+
+		if (child + 1 < len
+			&& vinternal_cmp(base + (child * size), base + ((child + 1) * size), cmp, reverse) < 0)
+		{
+			child++;
+		}
+
+		if (vinternal_cmp(base + (root * size), base + (child * size), cmp, reverse) >= 0)
+			return;
+
+		vinternal_swap(base + (root * size), base + (child * size), size);
+
+		root = child;
+	}
+}
+
+static
+void vinternal_heap_make(char *base, size_t len, size_t size, VecCmp cmp, bool reverse)
+{
+	for (size_t i = len >> 1; i-- > 0;)
+		vinternal_sift_down(base, i, len, size, cmp, reverse);
+}
+
+/**
+ * Sort a heap created with the same cmp and reverse.
+ */
+static
+void vinternal_heap_sort(char *base, size_t len, size_t size, VecCmp cmp, bool reverse)
+{
+	while (len > 1)
+	{
+		len--;
+		vinternal_swap(base, base + (len * size), size);
+		vinternal_sift_down(base, 0, len, size, cmp, reverse);
+	}
+}
+
+/**
+ * Move the k smallest elements into a heap at the front of the range,
+ * or the k greatest ones if reverse is set. k has to be non-zero.
+ */
+static
+void vinternal_heap_select(char *base, size_t len, size_t k, size_t size, VecCmp cmp, bool reverse)
+{
+	vinternal_heap_make(base, k, size, cmp, reverse);
+
+	for (size_t i = k; i < len; i++)
+	{
+		char *cur = base + (i * size);
+
+		if (vinternal_cmp(cur, base, cmp, reverse) < 0)
+		{
+			vinternal_swap(cur, base, size);
+			vinternal_sift_down(base, 0, k, size, cmp, reverse);
+		}
+	}
+}
+
+/**
+ * Partition a range around the median of its first, middle and last
+ * element. Returns the final index of the pivot. len has to be at least 3.
+ */
+static
+size_t vinternal_partition(char *base, size_t len, size_t size, VecCmp cmp)
+{
+	char *lo = base;
+	char *mid = base + ((len >> 1) * size);
+	char *hi = base + ((len - 1) * size);
+
+	if (cmp(mid, lo) < 0)
+		vinternal_swap(mid, lo, size);
+	if (cmp(hi, mid) < 0)
+	{
+		vinternal_swap(hi, mid, size);
+		if (cmp(mid, lo) < 0)
+			vinternal_swap(mid, lo, size);
+	}
+
+	vinternal_swap(base, mid, size);
+
+	size_t i = 1, j = len - 1;
+
+	for (;;)
+	{
+		while (i <= j && cmp(base + (i * size), base) < 0)
+			i++;
+		while (i <= j && cmp(base + (j * size), base) > 0)
+			j--;
+
+		if (i >= j)
+			break;
+
+		vinternal_swap(base + (i * size), base + (j * size), size);
+		i++;
+		j--;
+	}
+
+	vinternal_swap(base, base + (j * size), size);
+
+	return j;
+}
+
+/**
+ * Introselect: move the nth smallest element to index n,
+ * with no greater elements before and no smaller ones after it.
+ */
+static
+void vinternal_select(char *base, size_t len, size_t n, size_t size, VecCmp cmp)
+{
+	size_t depth = vinternal_depth_limit(len);
+
+	while (len > VINTERNAL_SMALL_SORT)
+	{
+		if (depth-- == 0)
+		{
+			vinternal_heap_select(base, len, n + 1, size, cmp, false);
+			vinternal_swap(base, base + (n * size), size);
+			return;
+		}
+
+		size_t pivot = vinternal_partition(base, len, size, cmp);
+
+		if (pivot == n)
+			return;
+
+		if (n < pivot)
+		{
+			len = pivot;
+		}
+		else
+		{
+			base += (pivot + 1) * size;
+			n -= pivot + 1;
+			len -= pivot + 1;
+		}
+	}
+
+	vinternal_insertion_sort(base, len, size, cmp);
+}
+
+/**
+ * Introsort: quicksort recursing into the smaller partition,
+ * heapsort once depth is exhausted.
+ */
+static
+void vinternal_sort(char *base, size_t len, size_t size, VecCmp cmp, size_t depth)
+{
+	while (len > VINTERNAL_SMALL_SORT)
+	{
+		if (depth-- == 0)
+		{
+			vinternal_heap_make(base, len, size, cmp, false);
+			vinternal_heap_sort(base, len, size, cmp, false);
+			return;
+		}
+
+		size_t pivot = vinternal_partition(base, len, size, cmp);
+		size_t upper_len = len - pivot - 1;
+		char *upper = base + ((pivot + 1) * size);
+
+		if (pivot < upper_len)
+		{
+			vinternal_sort(base, pivot, size, cmp, depth);
+			base = upper;
+			len = upper_len;
+		}
+		else
+		{
+			vinternal_sort(upper, upper_len, size, cmp, depth);
+			len = pivot;
+		}
+	}
+
+	vinternal_insertion_sort(base, len, size, cmp);
+}
+
+
+/**
+ * Define a comparison function for a numeric type.
+ */
+#define VMACRO_DEFINE_NUM_CMP(name, type)									\
+static																		\
+int name(const void *a, const void *b)										\
+{																			\
+	const type x = *(const type *) a;										\
+	const type y = *(const type *) b;										\
+	return (x > y) - (x < y);												\
+}
+
+VMACRO_DEFINE_NUM_CMP(vinternal_cmp_i32, int32_t)
+VMACRO_DEFINE_NUM_CMP(vinternal_cmp_i64, int64_t)
+VMACRO_DEFINE_NUM_CMP(vinternal_cmp_u32, uint32_t)
+VMACRO_DEFINE_NUM_CMP(vinternal_cmp_u64, uint64_t)
+VMACRO_DEFINE_NUM_CMP(vinternal_cmp_f32, float)
+VMACRO_DEFINE_NUM_CMP(vinternal_cmp_f64, double)
+
+/**
+ * Define an introselect working directly on a numeric type,
+ * see vinternal_select.
+ */
+#define VMACRO_DEFINE_NUM_SELECT(name, type, cmp)							\
+static																		\
+void name(type *base, size_t len, size_t n)									\
+{																			\
+	size_t depth = vinternal_depth_limit(len);								\
+																			\
+	while (len > VINTERNAL_SMALL_SORT)										\
+	{																		\
+		if (depth-- == 0)													\
+		{																	\
+			vinternal_select((char *) base, len, n, sizeof(type), cmp);		\
+			return;															\
+		}																	\
+																			\
+		type tmp;															\
+		size_t mid = len >> 1, last = len - 1;								\
+																			\
+		if (base[mid] < base[0])											\
+			{ tmp = base[mid]; base[mid] = base[0]; base[0] = tmp; }		\
+		if (base[last] < base[mid])											\
+		{																	\
+			tmp = base[last]; base[last] = base[mid]; base[mid] = tmp;		\
+			if (base[mid] < base[0])										\
+				{ tmp = base[mid]; base[mid] = base[0]; base[0] = tmp; }	\
+		}																	\
+																			\
+		const type pivot = base[mid];										\
+		base[mid] = base[0];												\
+		base[0] = pivot;													\
+																			\
+		size_t i = 1, j = last;												\
+																			\
+		for (;;)															\
+		{																	\
+			while (i <= j && base[i] < pivot)								\
+				i++;														\
+			while (i <= j && pivot < base[j])								\
+				j--;														\
+																			\
+			if (i >= j)														\
+				break;														\
+																			\
+			tmp = base[i]; base[i] = base[j]; base[j] = tmp;				\
+			i++;															\
+			j--;															\
+		}																	\
+																			\
+		base[0] = base[j];													\
+		base[j] = pivot;													\
+																			\
+		if (j == n)															\
+			return;															\
+																			\
+		if (n < j)															\
+		{																	\
+			len = j;														\
+		}																	\
+		else																\
+		{																	\
+			base += j + 1;													\
+			n -= j + 1;														\
+			len -= j + 1;													\
+		}																	\
+	}																		\
+																			\
+	for (size_t i = 1; i < len; i++)										\
+	{																		\
+		const type cur = base[i];											\
+		size_t j = i;														\
+																			\
+		for (; j > 0 && cur < base[j - 1]; j--)								\
+			base[j] = base[j - 1];											\
+																			\
+		base[j] = cur;														\
+	}																		\
+}
+
+VMACRO_DEFINE_NUM_SELECT(vinternal_select_i32, int32_t, vinternal_cmp_i32)
+VMACRO_DEFINE_NUM_SELECT(vinternal_select_i64, int64_t, vinternal_cmp_i64)
+VMACRO_DEFINE_NUM_SELECT(vinternal_select_u32, uint32_t, vinternal_cmp_u32)
+VMACRO_DEFINE_NUM_SELECT(vinternal_select_u64, uint64_t, vinternal_cmp_u64)
+VMACRO_DEFINE_NUM_SELECT(vinternal_select_f32, float, vinternal_cmp_f32)
+VMACRO_DEFINE_NUM_SELECT(vinternal_select_f64, double, vinternal_cmp_f64)
+
+/**
+ * Element sizes of the numeric types.
+ */
+static const size_t VINTERNAL_NUM_SIZES[] =
+{
+	[VN_INT32]	= sizeof(int32_t),
+	[VN_INT64]	= sizeof(int64_t),
+	[VN_UINT32]	= sizeof(uint32_t),
+	[VN_UINT64]	= sizeof(uint64_t),
+	[VN_FLOAT]	= sizeof(float),
+	[VN_DOUBLE]	= sizeof(double),
+};
+
+/**
+ * Check whether elements of a given size can be of a numeric type.
+ */
+static inline
+bool vinternal_num_valid_size(size_t elem_size, enum VecNum type)
+{
+	return (type >= 0 && type < VINTERNAL_NUM_LAST
+		&& elem_size == VINTERNAL_NUM_SIZES[type]);
+}
+
+/**
+ * Check whether a vector can hold elements of a numeric type.
+ */
+static inline
+bool vinternal_num_valid(Vec *vec, enum VecNum type)
+{
+	return vinternal_num_valid_size(vec->elem_size, type);
+}
+
+
+/**
+ * Arity of the heap layout used by the heap functions.
+ */
+static inline
+size_t vinternal_heap_arity(Vec *vec)
+{
+	return vinternal_c_quadheap(vec) ? 4 : 2;
+}
+
+/**
+ * Move the hole at index down the max heap until value fits into it,
+ * moving the greater children up instead of swapping, then copy value
+ * into the hole. value must not point into the heap.
+ */
+static
+void vinternal_heap_hole_down(char *base, size_t hole, size_t len, size_t size, size_t arity,
+	VecCmp cmp, const void *value)
+{
+	for (;;)
+	{
+		size_t child = (hole * arity) + 1;
+
+		if (child >= len)
+			break;
+
+		size_t end = (len - child < arity) ? len : child + arity;
+		size_t max = child;
+
+		for (child++; child < end; child++)
+		{
+			if (cmp(base + (max * size), base + (child * size)) < 0)
+				max = child;
+		}
+
+		if (cmp(value, base + (max * size)) >= 0)
+			break;
+
+		memcpy(
+			base + (hole * size),
+			base + (max * size),
+			size);
+
+		hole = max;
+	}
+
+	memcpy(
+		base + (hole * size),
+		value,
+		size);
+}
+
+/**
+ * Move the hole at index up the max heap until value fits into it,
+ * then copy value into the hole. value must not point into the heap
+ * above the hole.
+ */
+static
+void vinternal_heap_hole_up(char *base, size_t hole, size_t size, size_t arity,
+	VecCmp cmp, const void *value)
+{
+	while (hole > 0)
+	{
+		size_t parent = (hole - 1) / arity;
+
+		if (cmp(base + (parent * size), value) >= 0)
+			break;
+
+		memcpy(
+			base + (hole * size),
+			base + (parent * size),
+			size);
+
+		hole = parent;
+	}
+
+	memcpy(
+		base + (hole * size),
+		value,
+		size);
+}
+
+/**
+ * Copy one element of the specified size.
+ * Common element sizes are copied through registers.
+ */
+static inline
+void vinternal_copy(void *dest, const void *src, size_t size)
+{
+	switch (size)
+	{
+		case 4:
+		{
+			uint32_t tmp;
+			memcpy(&tmp, src, 4);
+			memcpy(dest, &tmp, 4);
+			return;
+		}
+		case 8:
+		{
+			uint64_t tmp;
+			memcpy(&tmp, src, 8);
+			memcpy(dest, &tmp, 8);
+			return;
+		}
+		default:
+			memcpy(dest, src, size);
+	}
+}
+
+/**
+ * Cursor into one sorted run of a k-way merge.
+ */
+struct vinternal_MergeRun
+{
+	char *pos, *end;
+};
+
+/**
+ * Whether run a wins against run b in a loser tree.
+ * Exhausted runs lose against everything and ties are
+ * won by the earlier run to keep the merge stable.
+ */
+static inline
+bool vinternal_merge_beats(struct vinternal_MergeRun *runs, size_t a, size_t b, VecCmp cmp)
+{
+	if (runs[a].pos == runs[a].end)
+		return false;
+
+	if (runs[b].pos == runs[b].end)
+		return true;
+
+	int res = cmp(runs[a].pos, runs[b].pos);
+
+	return (res < 0 || (res == 0 && a < b));
+}
+
+/**
+ * Build the subtree of a loser tree below node.
+ * Leaves are the nodes k to 2k - 1, every inner node stores the
+ * loser of its subtrees. Returns the winner of the subtree.
+ */
+static
+size_t vinternal_merge_build(size_t *tree, size_t node, size_t k,
+	struct vinternal_MergeRun *runs, VecCmp cmp)
+{
+	if (node >= k)
+		return node - k;
+
+	size_t left = vinternal_merge_build(tree, node << 1, k, runs, cmp);
+	size_t right = vinternal_merge_build(tree, (node << 1) + 1, k, runs, cmp);
+
+	if (vinternal_merge_beats(runs, right, left, cmp))
+	{
+		tree[node] = left;
+		return right;
+	}
+
+	tree[node] = right;
+	return left;
+}
+
+/**
+ * Append an element to a merge output that has enough capacity,
+ * skipping it if unique is set and it equals the previous one.
+ */
+static inline
+void vinternal_merge_emit(Vec *out, const void *elem, VecCmp cmp, bool unique)
+{
+	if (unique && out->len > 0
+		&& cmp(((char *) out->last) - out->elem_size, elem) == 0)
+	{
+		return;
+	}
+
+	vinternal_copy(out->last, elem, out->elem_size);
+
+	out->last = ((char *) out->last) + out->elem_size;
+	out->len++;
+}
+
+/**
+ * Clear an output vector and reserve space for len elements at once.
+ * A buffer shared with snapshots is dropped by the clear, so it
+ * does not count as space. If the space cannot be reserved,
+ * the output vector is left untouched.
+ */
+static inline
+int vinternal_prepare_out(Vec *out, size_t len)
+{
+	size_t new_cap = (out->shared == NULL) ? out->cap : 0;
+	void *new_data = NULL;
+
+	if (new_cap < len)
+	{
+		if (vinternal_c_noautogrow(out))
+			return VE_NOCAP;
+
+		while (len > new_cap)
+			new_cap = vinternal_size_t_double(new_cap);
+
+		if (new_cap > ((size_t) SIZE_MAX) / out->elem_size)
+			return VE_NOMEM;
+
+		new_data = malloc(new_cap * out->elem_size);
+
+		if (new_data == NULL)
+			return VE_NOMEM;
+	}
+
+	v_softclear(out);
+
+	if (new_data != NULL)
+	{
+		free(out->data);
+
+		out->data = out->first = out->last = new_data;
+		out->cap = new_cap;
+		out->offset = 0;
+	}
+	else if (len > 0)
+	{
+		// the buffer is large enough, at worst the offset gets zeroed
+		VMACRO_RETURN_MAYBE(
+			vinternal_grow_maybe(out, len, false));
+	}
+
+	return VE_OK;
+}
+
+/**
+ * Numeric kernels process blocks of VINTERNAL_NUM_BLOCK elements.
+ * With GCC style vector extensions, blocks are SIMD vectors and
+ * on x86-64 every kernel is compiled for SSE2, AVX2 and AVX-512,
+ * picking the best version at load time. Without them, blocks
+ * are single elements and the same code runs as scalar loops.
+ */
+#if defined(__GNUC__) && (defined(__clang__) || __GNUC__ >= 9)
+#define VINTERNAL_NUM_BLOCK 8
+#define VMACRO_NUM_VECTOR(type) __attribute__((vector_size(8 * sizeof(type))))
+#define VMACRO_NUM_CONVERT(x, type) __builtin_convertvector(x, type)
+#define VMACRO_NUM_LANE(x, i) ((x)[i])
+#define VMACRO_NUM_SELECT(mask, a, b, type, mask_type)						\
+	((type) (((mask_type) (a) & (mask)) | ((mask_type) (b) & ~(mask))))
+#define VMACRO_NUM_REVERSE(x, type)											\
+	((type) { (x)[7], (x)[6], (x)[5], (x)[4], (x)[3], (x)[2], (x)[1], (x)[0] })
+#else
+#define VINTERNAL_NUM_BLOCK 1
+#define VMACRO_NUM_VECTOR(type)
+#define VMACRO_NUM_CONVERT(x, type) ((type) (x))
+#define VMACRO_NUM_LANE(x, i) (x)
+#define VMACRO_NUM_SELECT(mask, a, b, type, mask_type) ((mask) ? (a) : (b))
+#define VMACRO_NUM_REVERSE(x, type) (x)
+#endif
+
+#if VINTERNAL_NUM_BLOCK > 1 && !defined(__clang__) && defined(__x86_64__) && defined(__GLIBC__)
+#define VMACRO_NUM_TARGETS __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define VMACRO_NUM_TARGETS
+#endif
+
+typedef uint8_t		vinternal_nv_u8		VMACRO_NUM_VECTOR(uint8_t);
+typedef uint16_t	vinternal_nv_u16	VMACRO_NUM_VECTOR(uint16_t);
+typedef int32_t		vinternal_nv_i32	VMACRO_NUM_VECTOR(int32_t);
+typedef int64_t		vinternal_nv_i64	VMACRO_NUM_VECTOR(int64_t);
+typedef uint32_t	vinternal_nv_u32	VMACRO_NUM_VECTOR(uint32_t);
+typedef uint64_t	vinternal_nv_u64	VMACRO_NUM_VECTOR(uint64_t);
+typedef float		vinternal_nv_f32	VMACRO_NUM_VECTOR(float);
+typedef double		vinternal_nv_f64	VMACRO_NUM_VECTOR(double);
+
+/**
+ * Define the numeric kernels for one element type.
+ * type is the element type, arith_type the type arithmetic is done in so
+ * that integers wrap around, acc_type the type sums are accumulated in and
+ * res_type the type they are returned as. Integer sums are accumulated
+ * unsigned, so that they wrap around instead of overflowing.
+ * The v* parameters are the block types of the respective types and
+ * vmask the block type comparisons of elements result in.
+ */
+#define VMACRO_DEFINE_NUM_KERNELS(sfx, type, arith_type, acc_type, res_type,	\
+	vtype, varith, vacc, vmask)												\
+VMACRO_NUM_TARGETS															\
+static																		\
+void vinternal_sum_##sfx(const void *src_raw, size_t len, void *dest)		\
+{																			\
+	const type *src = src_raw;												\
+	vacc acc0 = {0}, acc1 = {0};											\
+	size_t i = 0;															\
+																			\
+	for (; i + (2 * VINTERNAL_NUM_BLOCK) <= len; i += 2 * VINTERNAL_NUM_BLOCK)	\
+	{																		\
+		vtype x, y;															\
+		memcpy(&x, src + i, sizeof(x));										\
+		memcpy(&y, src + i + VINTERNAL_NUM_BLOCK, sizeof(y));				\
+		acc0 += VMACRO_NUM_CONVERT(x, vacc);								\
+		acc1 += VMACRO_NUM_CONVERT(y, vacc);								\
+	}																		\
+																			\
+	acc0 += acc1;															\
+	acc_type sum = 0;														\
+																			\
+	for (size_t l = 0; l < VINTERNAL_NUM_BLOCK; l++)						\
+		sum += VMACRO_NUM_LANE(acc0, l);									\
+																			\
+	for (; i < len; i++)													\
+		sum += (acc_type) src[i];											\
+																			\
+	const res_type res = (res_type) sum;									\
+	memcpy(dest, &res, sizeof(res));										\
+}																			\
+																			\
+VMACRO_NUM_TARGETS															\
+static																		\
+void vinternal_minmax_##sfx(const void *src_raw, size_t len, void *min_dest, void *max_dest)	\
+{																			\
+	const type *src = src_raw;												\
+	type min = src[0], max = src[0];										\
+	size_t i = 0;															\
+																			\
+	if (len >= VINTERNAL_NUM_BLOCK)											\
+	{																		\
+		vtype vmin, vmax;													\
+		memcpy(&vmin, src, sizeof(vmin));									\
+		vmax = vmin;														\
+																			\
+		for (i = VINTERNAL_NUM_BLOCK; i + VINTERNAL_NUM_BLOCK <= len; i += VINTERNAL_NUM_BLOCK)	\
+		{																	\
+			vtype x;														\
+			memcpy(&x, src + i, sizeof(x));									\
+			vmin = VMACRO_NUM_SELECT(x < vmin, x, vmin, vtype, vmask);		\
+			vmax = VMACRO_NUM_SELECT(vmax < x, x, vmax, vtype, vmask);		\
+		}																	\
+																			\
+		for (size_t l = 0; l < VINTERNAL_NUM_BLOCK; l++)					\
+		{																	\
+			if (VMACRO_NUM_LANE(vmin, l) < min)								\
+				min = VMACRO_NUM_LANE(vmin, l);								\
+			if (max < VMACRO_NUM_LANE(vmax, l))								\
+				max = VMACRO_NUM_LANE(vmax, l);								\
+		}																	\
+	}																		\
+																			\
+	for (; i < len; i++)													\
+	{																		\
+		if (src[i] < min)													\
+			min = src[i];													\
+		if (max < src[i])													\
+			max = src[i];													\
+	}																		\
+																			\
+	if (min_dest != NULL)													\
+		memcpy(min_dest, &min, sizeof(min));								\
+	if (max_dest != NULL)													\
+		memcpy(max_dest, &max, sizeof(max));								\
+}																			\
+																			\
+VMACRO_NUM_TARGETS															\
+static																		\
+void vinternal_dot_##sfx(const void *a_raw, const void *b_raw, size_t len, void *dest)	\
+{																			\
+	const type *a = a_raw, *b = b_raw;										\
+	vacc acc = {0};															\
+	size_t i = 0;															\
+																			\
+	for (; i + VINTERNAL_NUM_BLOCK <= len; i += VINTERNAL_NUM_BLOCK)		\
+	{																		\
+		vtype x, y;															\
+		memcpy(&x, a + i, sizeof(x));										\
+		memcpy(&y, b + i, sizeof(y));										\
+		acc += VMACRO_NUM_CONVERT(x, vacc) * VMACRO_NUM_CONVERT(y, vacc);	\
+	}																		\
+																			\
+	acc_type sum = 0;														\
+																			\
+	for (size_t l = 0; l < VINTERNAL_NUM_BLOCK; l++)						\
+		sum += VMACRO_NUM_LANE(acc, l);										\
+																			\
+	for (; i < len; i++)													\
+		sum += (acc_type) a[i] * (acc_type) b[i];							\
+																			\
+	const res_type res = (res_type) sum;									\
+	memcpy(dest, &res, sizeof(res));										\
+}																			\
+																			\
+VMACRO_NUM_TARGETS															\
+static																		\
+void vinternal_scale_##sfx(void *dest_raw, size_t len, const void *factor_raw)	\
+{																			\
+	type *dest = dest_raw;													\
+	type factor_elem;														\
+	memcpy(&factor_elem, factor_raw, sizeof(factor_elem));					\
+	const arith_type factor = (arith_type) factor_elem;						\
+	size_t i = 0;															\
+																			\
+	for (; i + VINTERNAL_NUM_BLOCK <= len; i += VINTERNAL_NUM_BLOCK)		\
+	{																		\
+		varith x;															\
+		memcpy(&x, dest + i, sizeof(x));									\
+		x *= factor;														\
+		memcpy(dest + i, &x, sizeof(x));									\
+	}																		\
+																			\
+	for (; i < len; i++)													\
+		dest[i] = (type) ((arith_type) dest[i] * factor);					\
+}																			\
+																			\
+VMACRO_NUM_TARGETS															\
+static																		\
+void vinternal_add_##sfx(void *dest_raw, const void *src_raw, size_t len)	\
+{																			\
+	type *dest = dest_raw;													\
+	const type *src = src_raw;												\
+	size_t i = 0;															\
+																			\
+	for (; i + VINTERNAL_NUM_BLOCK <= len; i += VINTERNAL_NUM_BLOCK)		\
+	{																		\
+		varith x, y;														\
+		memcpy(&x, dest + i, sizeof(x));									\
+		memcpy(&y, src + i, sizeof(y));										\
+		x += y;																\
+		memcpy(dest + i, &x, sizeof(x));									\
+	}																		\
+																			\
+	for (; i < len; i++)													\
+		dest[i] = (type) ((arith_type) dest[i] + (arith_type) src[i]);		\
+}																			\
+																			\
+VMACRO_NUM_TARGETS															\
+static																		\
+void vinternal_scan_##sfx(const void *src_raw, void *dest_raw, size_t len,	\
+	void *carry, bool inclusive, const unsigned char *flags)				\
+{																			\
+	const type *src = src_raw;												\
+	type *dest = dest_raw;													\
+	type carry_elem;														\
+	memcpy(&carry_elem, carry, sizeof(carry_elem));							\
+	arith_type acc = (arith_type) carry_elem;								\
+																			\
+	if (flags == NULL && inclusive)											\
+	{																		\
+		for (size_t i = 0; i < len; i++)									\
+			dest[i] = (type) (acc += (arith_type) src[i]);					\
+	}																		\
+	else if (flags == NULL)													\
+	{																		\
+		for (size_t i = 0; i < len; i++)									\
+		{																	\
+			const arith_type x = (arith_type) src[i];						\
+			dest[i] = (type) acc;											\
+			acc += x;														\
+		}																	\
+	}																		\
+	else																	\
+	{																		\
+		for (size_t i = 0; i < len; i++)									\
+		{																	\
+			const arith_type x = (arith_type) src[i];						\
+			if (flags[i])													\
+				acc = 0;													\
+			if (inclusive)													\
+				acc += x;													\
+			dest[i] = (type) acc;											\
+			if (!inclusive)													\
+				acc += x;													\
+		}																	\
+	}																		\
+																			\
+	carry_elem = (type) acc;												\
+	memcpy(carry, &carry_elem, sizeof(carry_elem));							\
+}
+
+VMACRO_DEFINE_NUM_KERNELS(i32, int32_t, uint32_t, uint64_t, int64_t,
+	vinternal_nv_i32, vinternal_nv_u32, vinternal_nv_u64, vinternal_nv_i32)
+VMACRO_DEFINE_NUM_KERNELS(i64, int64_t, uint64_t, uint64_t, int64_t,
+	vinternal_nv_i64, vinternal_nv_u64, vinternal_nv_u64, vinternal_nv_i64)
+VMACRO_DEFINE_NUM_KERNELS(u32, uint32_t, uint32_t, uint64_t, uint64_t,
+	vinternal_nv_u32, vinternal_nv_u32, vinternal_nv_u64, vinternal_nv_i32)
+VMACRO_DEFINE_NUM_KERNELS(u64, uint64_t, uint64_t, uint64_t, uint64_t,
+	vinternal_nv_u64, vinternal_nv_u64, vinternal_nv_u64, vinternal_nv_i64)
+VMACRO_DEFINE_NUM_KERNELS(f32, float, float, double, double,
+	vinternal_nv_f32, vinternal_nv_f32, vinternal_nv_f64, vinternal_nv_i32)
+VMACRO_DEFINE_NUM_KERNELS(f64, double, double, double, double,
+	vinternal_nv_f64, vinternal_nv_f64, vinternal_nv_f64, vinternal_nv_i64)
+
+/**
+ * Numeric kernels of one element type.
+ */
+struct vinternal_NumKernels
+{
+	void (*sum)(const void *src, size_t len, void *dest);
+	void (*minmax)(const void *src, size_t len, void *min, void *max);
+	void (*dot)(const void *a, const void *b, size_t len, void *dest);
+	void (*scale)(void *dest, size_t len, const void *factor);
+	void (*add)(void *dest, const void *src, size_t len);
+	void (*scan)(const void *src, void *dest, size_t len,
+		void *carry, bool inclusive, const unsigned char *flags);
+};
+
+#define VMACRO_NUM_KERNELS(sfx)												\
+{																			\
+	vinternal_sum_##sfx,													\
+	vinternal_minmax_##sfx,													\
+	vinternal_dot_##sfx,													\
+	vinternal_scale_##sfx,													\
+	vinternal_add_##sfx,													\
+	vinternal_scan_##sfx,													\
+}
+
+static const struct vinternal_NumKernels VINTERNAL_NUM_KERNELS[] =
+{
+	[VN_INT32]	= VMACRO_NUM_KERNELS(i32),
+	[VN_INT64]	= VMACRO_NUM_KERNELS(i64),
+	[VN_UINT32]	= VMACRO_NUM_KERNELS(u32),
+	[VN_UINT64]	= VMACRO_NUM_KERNELS(u64),
+	[VN_FLOAT]	= VMACRO_NUM_KERNELS(f32),
+	[VN_DOUBLE]	= VMACRO_NUM_KERNELS(f64),
+};
+
+#undef VMACRO_NUM_KERNELS
+#undef VMACRO_DEFINE_NUM_KERNELS
+
+/**
+ * Define an in-place reverse for elements of one size,
+ * reversing whole blocks with a single shuffle each.
+ */
+#define VMACRO_DEFINE_REVERSE(sfx, type, vtype)								\
+VMACRO_NUM_TARGETS															\
+static																		\
+void vinternal_reverse_##sfx(void *base, size_t len)						\
+{																			\
+	type *lo = base, *hi = lo + len;										\
+																			\
+	while ((size_t) (hi - lo) >= 2 * VINTERNAL_NUM_BLOCK)					\
+	{																		\
+		hi -= VINTERNAL_NUM_BLOCK;											\
+																			\
+		vtype x, y;															\
+		memcpy(&x, lo, sizeof(x));											\
+		memcpy(&y, hi, sizeof(y));											\
+		x = VMACRO_NUM_REVERSE(x, vtype);									\
+		y = VMACRO_NUM_REVERSE(y, vtype);									\
+		memcpy(lo, &y, sizeof(y));											\
+		memcpy(hi, &x, sizeof(x));											\
+																			\
+		lo += VINTERNAL_NUM_BLOCK;											\
+	}																		\
+																			\
+	while (hi - lo > 1)														\
+	{																		\
+		hi--;																\
+		type tmp = *lo;														\
+		*lo = *hi;															\
+		*hi = tmp;															\
+		lo++;																\
+	}																		\
+}
+
+VMACRO_DEFINE_REVERSE(u8, uint8_t, vinternal_nv_u8)
+VMACRO_DEFINE_REVERSE(u16, uint16_t, vinternal_nv_u16)
+VMACRO_DEFINE_REVERSE(u32, uint32_t, vinternal_nv_u32)
+VMACRO_DEFINE_REVERSE(u64, uint64_t, vinternal_nv_u64)
+
+#undef VMACRO_DEFINE_REVERSE
+
+/**
+ * Reverse len elements of any size in place.
+ */
+static
+void vinternal_reverse(void *base, size_t len, size_t size)
+{
+	switch (size)
+	{
+		case 1:
+			vinternal_reverse_u8(base, len);
+			return;
+		case 2:
+			vinternal_reverse_u16(base, len);
+			return;
+		case 4:
+			vinternal_reverse_u32(base, len);
+			return;
+		case 8:
+			vinternal_reverse_u64(base, len);
+			return;
+		default:
+			break;
+	}
+
+	char *lo = base, *hi = lo + (len * size);
+
+	while (hi - lo > (ptrdiff_t) size)
+	{
+		hi -= size;
+		vinternal_swap(lo, hi, size);
+		lo += size;
+	}
+}
+
+/**
+ * Rotate a range consisting of a left and a right part, given in bytes,
+ * so that the right part comes first. Swaps the shorter part with the
+ * same amount of bytes from the other end of the range until both parts
+ * are in place, without any extra buffer.
+ */
+static
+void vinternal_rotate(char *base, size_t left, size_t right)
+{
+	while (left != 0 && right != 0)
+	{
+		if (left <= right)
+		{
+			vinternal_swap(base, base + left, left);
+			base += left;
+			right -= left;
+		}
+		else
+		{
+			vinternal_swap(base + (left - right), base + left, right);
+			left -= right;
+		}
+	}
+}
+
+/**
+ * Elements v_argsort compares indices by. Thread-local, since
+ * VecCmp takes no context to pass them to vinternal_arg_cmp.
+ */
+static VINTERNAL_THREAD_LOCAL struct
+{
+	const char *base;
+	size_t size;
+	VecCmp cmp;
+} vinternal_arg_ctx;
+
+/**
+ * Compare two indices by the elements at them, breaking
+ * ties by index so that sorting indices is stable.
+ */
+static
+int vinternal_arg_cmp(const void *a, const void *b)
+{
+	size_t x, y;
+	memcpy(&x, a, sizeof(x));
+	memcpy(&y, b, sizeof(y));
+
+	int res = vinternal_arg_ctx.cmp(
+		vinternal_arg_ctx.base + (x * vinternal_arg_ctx.size),
+		vinternal_arg_ctx.base + (y * vinternal_arg_ctx.size));
+
+	return (res != 0) ? res : (x > y) - (x < y);
+}
+
+/**
+ * Marks visited indices of a permutation while applying it.
+ */
+static const size_t VINTERNAL_PERM_MARK = ~(((size_t) SIZE_MAX) >> 1);
+
+/**
+ * Fill count elements at dest with copies of elem by doubling
+ * the filled range with every copy, so any element size is
+ * broadcast with O(log count) bulk copies.
+ */
+static
+void vinternal_fill(void *dest, const void *elem, size_t size, size_t count)
+{
+	if (count == 0)
+		return;
+
+	if (size == 1)
+	{
+		memset(dest, *(const unsigned char *) elem, count);
+		return;
+	}
+
+	size_t total = count * size;
+	size_t filled = size;
+
+	memcpy(dest, elem, size);
+
+	while (filled < total)
+	{
+		size_t chunk = (filled < total - filled) ? filled : total - filled;
+
+		memcpy(((char *) dest) + filled, dest, chunk);
+
+		filled += chunk;
+	}
+}
+
+/**
+ * Minimum size in bytes of a zeroed extension to be taken
+ * from calloc instead of being written over.
+ */
+static const size_t VINTERNAL_CALLOC_MIN = 1 << 16;
+
+/**
+ * Primes of the 64 bit hash function.
+ */
+static const uint64_t VINTERNAL_HASH_P1 = UINT64_C(11400714785074694791);
+static const uint64_t VINTERNAL_HASH_P2 = UINT64_C(14029467366897019727);
+static const uint64_t VINTERNAL_HASH_P3 = UINT64_C(1609587929392839161);
+static const uint64_t VINTERNAL_HASH_P4 = UINT64_C(9650029242287828579);
+static const uint64_t VINTERNAL_HASH_P5 = UINT64_C(2870177450012600261);
+
+static inline
+uint64_t vinternal_rotl64(uint64_t x, unsigned r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline
+uint64_t vinternal_hash_round(uint64_t acc, uint64_t input)
+{
+	acc += input * VINTERNAL_HASH_P2;
+	acc = vinternal_rotl64(acc, 31);
+
+	return acc * VINTERNAL_HASH_P1;
+}
+
+static inline
+uint64_t vinternal_hash_merge(uint64_t acc, uint64_t lane)
+{
+	acc ^= vinternal_hash_round(0, lane);
+
+	return (acc * VINTERNAL_HASH_P1) + VINTERNAL_HASH_P4;
+}
+
+/**
+ * 64 bit non-cryptographic hash of a byte stream (XXH64).
+ * Stripes of 32 bytes are consumed by four independent lanes.
+ * Words are read in native byte order.
+ */
+static
+uint64_t vinternal_hash(const void *data, size_t len, uint64_t seed)
+{
+	const unsigned char *p = data;
+	const unsigned char *end = p + len;
+	uint64_t h, word;
+
+	if (len >= 32)
+	{
+		uint64_t lanes[4] =
+		{
+			seed + VINTERNAL_HASH_P1 + VINTERNAL_HASH_P2,
+			seed + VINTERNAL_HASH_P2,
+			seed,
+			seed - VINTERNAL_HASH_P1,
+		};
+
+		for (; end - p >= 32; p += 32)
+		{
+			for (size_t l = 0; l < 4; l++)
+			{
+				memcpy(&word, p + (l * 8), 8);
+				lanes[l] = vinternal_hash_round(lanes[l], word);
+			}
+		}
+
+		h = vinternal_rotl64(lanes[0], 1) + vinternal_rotl64(lanes[1], 7)
+			+ vinternal_rotl64(lanes[2], 12) + vinternal_rotl64(lanes[3], 18);
+
+		for (size_t l = 0; l < 4; l++)
+			h = vinternal_hash_merge(h, lanes[l]);
+	}
+	else
+	{
+		h = seed + VINTERNAL_HASH_P5;
+	}
+
+	h += (uint64_t) len;
+
+	for (; end - p >= 8; p += 8)
+	{
+		memcpy(&word, p, 8);
+		h ^= vinternal_hash_round(0, word);
+		h = (vinternal_rotl64(h, 27) * VINTERNAL_HASH_P1) + VINTERNAL_HASH_P4;
+	}
+
+	if (end - p >= 4)
+	{
+		uint32_t half;
+		memcpy(&half, p, 4);
+		h ^= (uint64_t) half * VINTERNAL_HASH_P1;
+		h = (vinternal_rotl64(h, 23) * VINTERNAL_HASH_P2) + VINTERNAL_HASH_P3;
+		p += 4;
+	}
+
+	for (; p < end; p++)
+	{
+		h ^= (uint64_t) *p * VINTERNAL_HASH_P5;
+		h = vinternal_rotl64(h, 11) * VINTERNAL_HASH_P1;
+	}
+
+	h ^= h >> 33;
+	h *= VINTERNAL_HASH_P2;
+	h ^= h >> 29;
+	h *= VINTERNAL_HASH_P3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+/**
+ * Define an intersection of two strictly increasing numeric ranges.
+ * Every block of a is compared against every element of the current
+ * block of b at once, advancing the block with the smaller maximum.
+ * Returns the amount of elements written to out.
+ */
+#define VMACRO_DEFINE_NUM_INTERSECT(sfx, type, vtype, vmask)				\
+VMACRO_NUM_TARGETS															\
+static																		\
+size_t vinternal_intersect_##sfx(const void *a_raw, size_t a_len,			\
+	const void *b_raw, size_t b_len, void *out_raw)							\
+{																			\
+	const type *a = a_raw, *b = b_raw;										\
+	type *out = out_raw;													\
+	size_t i = 0, j = 0, n = 0;												\
+																			\
+	while (i + VINTERNAL_NUM_BLOCK <= a_len && j + VINTERNAL_NUM_BLOCK <= b_len)	\
+	{																		\
+		vtype x, y;															\
+		memcpy(&x, a + i, sizeof(x));										\
+		memcpy(&y, b + j, sizeof(y));										\
+																			\
+		vmask hit = {0};													\
+																			\
+		for (size_t l = 0; l < VINTERNAL_NUM_BLOCK; l++)					\
+			hit |= (x == VMACRO_NUM_LANE(y, l));							\
+																			\
+		for (size_t l = 0; l < VINTERNAL_NUM_BLOCK; l++)					\
+		{																	\
+			if (VMACRO_NUM_LANE(hit, l))									\
+				out[n++] = VMACRO_NUM_LANE(x, l);							\
+		}																	\
+																			\
+		const type a_max = VMACRO_NUM_LANE(x, VINTERNAL_NUM_BLOCK - 1);		\
+		const type b_max = VMACRO_NUM_LANE(y, VINTERNAL_NUM_BLOCK - 1);		\
+																			\
+		if (a_max <= b_max)													\
+			i += VINTERNAL_NUM_BLOCK;										\
+		if (b_max <= a_max)													\
+			j += VINTERNAL_NUM_BLOCK;										\
+	}																		\
+																			\
+	while (i < a_len && j < b_len)											\
+	{																		\
+		if (a[i] < b[j])													\
+			i++;															\
+		else if (b[j] < a[i])												\
+			j++;															\
+		else																\
+		{																	\
+			out[n++] = a[i];												\
+			i++;															\
+			j++;															\
+		}																	\
+	}																		\
+																			\
+	return n;																\
+}
+
+VMACRO_DEFINE_NUM_INTERSECT(i32, int32_t, vinternal_nv_i32, vinternal_nv_i32)
+VMACRO_DEFINE_NUM_INTERSECT(i64, int64_t, vinternal_nv_i64, vinternal_nv_i64)
+VMACRO_DEFINE_NUM_INTERSECT(u32, uint32_t, vinternal_nv_u32, vinternal_nv_i32)
+VMACRO_DEFINE_NUM_INTERSECT(u64, uint64_t, vinternal_nv_u64, vinternal_nv_i64)
+VMACRO_DEFINE_NUM_INTERSECT(f32, float, vinternal_nv_f32, vinternal_nv_i32)
+VMACRO_DEFINE_NUM_INTERSECT(f64, double, vinternal_nv_f64, vinternal_nv_i64)
+
+#undef VMACRO_DEFINE_NUM_INTERSECT
+
+/**
+ * Comparison functions and intersections of the numeric types.
+ */
+static const VecCmp VINTERNAL_NUM_CMPS[] =
+{
+	[VN_INT32]	= vinternal_cmp_i32,
+	[VN_INT64]	= vinternal_cmp_i64,
+	[VN_UINT32]	= vinternal_cmp_u32,
+	[VN_UINT64]	= vinternal_cmp_u64,
+	[VN_FLOAT]	= vinternal_cmp_f32,
+	[VN_DOUBLE]	= vinternal_cmp_f64,
+};
+
+static size_t (*const VINTERNAL_NUM_INTERSECTS[])(const void *, size_t, const void *, size_t, void *) =
+{
+	[VN_INT32]	= vinternal_intersect_i32,
+	[VN_INT64]	= vinternal_intersect_i64,
+	[VN_UINT32]	= vinternal_intersect_u32,
+	[VN_UINT64]	= vinternal_intersect_u64,
+	[VN_FLOAT]	= vinternal_intersect_f32,
+	[VN_DOUBLE]	= vinternal_intersect_f64,
+};
+
+/**
+ * The smaller input of an intersection is searched for in the larger
+ * one instead of merging both once it is this many times smaller.
+ */
+static const size_t VINTERNAL_GALLOP_RATIO = 32;
+
+/**
+ * Find the first element of a sorted range that is not smaller than
+ * key, searching exponentially growing steps from the start first.
+ */
+static
+size_t vinternal_gallop(const char *base, size_t len, size_t size, const void *key, VecCmp cmp)
+{
+	size_t lo = 0, hi = 1;
+
+	while (hi < len && cmp(base + (hi * size), key) < 0)
+	{
+		lo = hi;
+		hi = vinternal_size_t_double(hi);
+	}
+
+	if (hi > len)
+		hi = len;
+
+	// the first element not smaller than key lies in (lo, hi]
+	if (lo == 0 && len > 0 && cmp(base, key) >= 0)
+		return 0;
+
+	while (hi - lo > 1)
+	{
+		size_t mid = lo + ((hi - lo) >> 1);
+
+		if (cmp(base + (mid * size), key) < 0)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return hi;
+}
+
+/**
+ * Intersect two sorted ranges, keeping min(m, n) copies of an element
+ * that occurs m times in a and n times in b. Galloping through the
+ * larger range if the inputs are skewed. Out has to have enough capacity.
+ */
+static
+void vinternal_intersect(Vec *a, Vec *b, VecCmp cmp, Vec *out)
+{
+	size_t size = out->elem_size;
+
+	if (a->len > b->len)
+	{
+		Vec *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	const char *x = a->first, *x_end = a->last;
+	const char *y = b->first, *y_end = b->last;
+
+	if (a->len * VINTERNAL_GALLOP_RATIO < b->len)
+	{
+		for (; x != x_end && y != y_end; x += size)
+		{
+			y += vinternal_gallop(y, (size_t) (y_end - y) / size, size, x, cmp) * size;
+
+			if (y != y_end && cmp(x, y) == 0)
+			{
+				vinternal_merge_emit(out, x, cmp, false);
+				y += size;
+			}
+		}
+
+		return;
+	}
+
+	while (x != x_end && y != y_end)
+	{
+		int res = cmp(x, y);
+
+		if (res < 0)
+			x += size;
+		else if (res > 0)
+			y += size;
+		else
+		{
+			vinternal_merge_emit(out, x, cmp, false);
+			x += size;
+			y += size;
+		}
+	}
+}
+
+/**
+ * Check whether the part at index of srcs can donate its buffer to
+ * dest, given the amount of elements that precede it in the result.
+ */
+static
+bool vinternal_can_adopt(Vec *dest, Vec **srcs, size_t n, size_t index, size_t preceding)
+{
+	Vec *part = srcs[index];
+
+	if (part == dest || part->data == NULL || part->shared != NULL
+		|| vinternal_owned(part) || part->offset < preceding)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < n; i++)
+	{
+		if (i != index && srcs[i] == part)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Append the elements of n vectors to dest, growing it at most once.
+ * If adopt is set, the buffer of the largest part that has enough room
+ * in front of its elements replaces the buffer of dest, so that this
+ * part stays where it is. The donating vector is left empty.
+ */
+static
+int vinternal_concat(Vec *dest, Vec **srcs, size_t n, bool adopt)
+{
+	size_t size = dest->elem_size;
+	size_t dest_len = dest->len;
+	size_t total = dest_len;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		if (srcs[i] == NULL || srcs[i]->elem_size != size)
+			return VE_INVAL;
+
+		total = vinternal_size_t_add(total, srcs[i]->len);
+	}
+
+	if (total > ((size_t) SIZE_MAX) / size)
+		return VE_NOMEM;
+
+	size_t donor = n;
+
+	if (adopt && !vinternal_c_noautogrow(dest))
+	{
+		size_t best = dest_len, preceding = dest_len;
+
+		for (size_t i = 0; i < n; i++)
+		{
+			if (srcs[i]->len > best && vinternal_can_adopt(dest, srcs, n, i, preceding))
+			{
+				best = srcs[i]->len;
+				donor = i;
+			}
+
+			preceding += srcs[i]->len;
+		}
+	}
+
+	if (donor == n)
+	{
+		VMACRO_RETURN_MAYBE(
+			vinternal_grow_maybe(dest, total, true));
+
+		dest->first = ((char *) dest->data) + (dest->offset * size);
+		dest->last = ((char *) dest->first) + (dest_len * size);
+
+		for (size_t i = 0; i < n; i++)
+		{
+			size_t len = (srcs[i] == dest) ? dest_len : srcs[i]->len;
+
+			vinternal_bulk_copy(dest->last, srcs[i]->first, len * size,
+				vinternal_c_parallelcopy(dest));
+			dest->last = ((char *) dest->last) + (len * size);
+		}
+
+		dest->len = total;
+
+		return VE_OK;
+	}
+
+	Vec *part = srcs[donor];
+
+	size_t preceding = dest_len;
+	for (size_t i = 0; i < donor; i++)
+		preceding += srcs[i]->len;
+
+	size_t lead = part->offset - preceding;
+	size_t cap = lead + total;
+	char *data = part->data;
+
+	if (cap > part->cap)
+	{
+		data = realloc(part->data, cap * size);
+
+		if (data == NULL)
+			return VE_NOMEM;
+	}
+	else
+	{
+		cap = part->cap;
+	}
+
+	char *pos = data + (lead * size);
+
+	vinternal_bulk_copy(pos, dest->first, dest_len * size,
+		vinternal_c_parallelcopy(dest));
+	pos += dest_len * size;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t bytes = ((srcs[i] == dest) ? dest_len : srcs[i]->len) * size;
+
+		if (i != donor)
+			vinternal_bulk_copy(pos, srcs[i]->first, bytes, vinternal_c_parallelcopy(dest));
+
+		pos += bytes;
+	}
+
+	free(dest->data);
+
+	dest->data = data;
+	dest->cap = cap;
+	dest->offset = lead;
+	dest->len = total;
+	dest->first = data + (lead * size);
+	dest->last = pos;
+
+	vinternal_release(part);
+
+	return VE_OK;
+}
+
+/**
+ * Update the elements an iterator sees if it iterates
+ * over a vector directly instead of over a snapshot.
+ */
+static inline
+void vinternal_iter_sync(VecIter *iter)
+{
+	if (iter->vec != NULL)
+	{
+		iter->first = iter->vec->first;
+		iter->len = iter->vec->len;
+	}
+}
+
+/**
+ * Amount of elements an iterator has left,
+ * clamped to the current length of its elements.
+ */
+static
+size_t vinternal_iter_left(VecIter *iter)
+{
+	vinternal_iter_sync(iter);
+
+	size_t len = iter->len;
+	size_t total;
+
+	if (iter->reverse)
+	{
+		total = (iter->from / iter->step) + 1;
+
+		if (total > iter->count)
+			total = iter->count;
+
+		if (iter->pos >= total || iter->from - (iter->pos * iter->step) >= len)
+			return 0;
+	}
+	else
+	{
+		if (iter->from >= len)
+			return 0;
+
+		total = ((len - iter->from - 1) / iter->step) + 1;
+
+		if (total > iter->count)
+			total = iter->count;
+
+		if (iter->pos >= total)
+			return 0;
+	}
+
+	return total - iter->pos;
+}
+
+/**
+ * Pointer to the next element of an iterator. Unchecked!
+ */
+static inline
+const char *vinternal_iter_finger(VecIter *iter)
+{
+	size_t offset = iter->pos * iter->step;
+	size_t index = iter->reverse
+		? iter->from - offset
+		: iter->from + offset;
+
+	return ((const char *) iter->first) + (index * iter->elem_size);
+}
+
+/**
+ * Initialize an iterator over count elements of a vector, starting
+ * at index from and moving step elements forwards or backwards.
+ * Unless the vector is set to V_ITERNOCOPY, the iterator works
+ * on a snapshot sharing its buffer.
+ */
+static
+int vinternal_iter_init(VecIter *iter, Vec *vec, size_t from, size_t count, size_t step, bool reverse)
+{
+	if (vinternal_c_iternocopy(vec) && vinternal_owned(vec))
+		return VE_INVAL;
+
+	*iter = (VecIter)
+	{
+		.vec = NULL,
+		.shared = NULL,
+		.first = vec->first,
+		.len = vec->len,
+		.elem_size = vec->elem_size,
+		.from = from,
+		.step = step,
+		.count = count,
+		.pos = 0,
+		.reverse = reverse,
+		.owner = false,
+	};
+
+	if (vinternal_c_iternocopy(vec))
+	{
+		iter->vec = vec;
+		return VE_OK;
+	}
+
+	// take a snapshot sharing the buffer instead of cloning it,
+	// the vector copies it only if it is modified while shared
+	if (vec->data != NULL && vec->shared == NULL)
+	{
+		vec->shared = malloc(sizeof(struct vinternal_Shared));
+		if (vec->shared == NULL)
+			return VE_NOMEM;
+
+		vec->shared->data = vec->data;
+		vec->shared->cap = vec->cap;
+		vec->shared->refs = 1;
+	}
+
+	if (vec->shared != NULL)
+		VMACRO_REF_INC(vec->shared->refs);
+
+	iter->shared = vec->shared;
+
+	return VE_OK;
+}
+
+/**
+ * Create an iterator on the heap.
+ */
+static
+VecIter *vinternal_iter_create(Vec *vec, size_t from, size_t count, size_t step, bool reverse)
+{
+	VecIter *iter = malloc(sizeof(VecIter));
+	if (iter == NULL)
+		return NULL;
+
+	if (vinternal_iter_init(iter, vec, from, count, step, reverse) != VE_OK)
+	{
+		free(iter);
+		return NULL;
+	}
+
+	return iter;
+}
+
+/**
+ * Amount of elements an adaptor produces per batch.
+ */
+static const size_t VINTERNAL_ITER_BATCH = 256;
+
+/**
+ * Lower bound of the amount of elements an iterator has left.
+ */
+static
+size_t vinternal_iter_hint(VecIter *iter)
+{
+	struct vinternal_IterAdaptor *ad = iter->adaptor;
+
+	if (ad == NULL)
+		return vinternal_iter_left(iter);
+
+	size_t hint = 0;
+
+	switch (ad->kind)
+	{
+		case VINTERNAL_ITER_MAP:
+			hint = vinternal_iter_hint(ad->src[0]);
+			break;
+
+		case VINTERNAL_ITER_FILTER:
+			break;
+
+		case VINTERNAL_ITER_TAKE:
+			hint = vinternal_iter_hint(ad->src[0]);
+
+			if (hint > ad->left)
+				hint = ad->left;
+			break;
+
+		case VINTERNAL_ITER_ZIP:
+		{
+			size_t a = vinternal_size_t_add(ad->in_count[0], vinternal_iter_hint(ad->src[0]));
+			size_t b = vinternal_size_t_add(ad->in_count[1], vinternal_iter_hint(ad->src[1]));
+
+			hint = (a < b) ? a : b;
+			break;
+		}
+
+		case VINTERNAL_ITER_CHAIN:
+			hint = vinternal_size_t_add(
+				vinternal_iter_hint(ad->src[0]),
+				vinternal_iter_hint(ad->src[1]));
+			break;
+	}
+
+	return vinternal_size_t_add(hint, ad->out_count);
+}
+
+/**
+ * Pull the next chunk of a source of an adaptor if
+ * the last one has been consumed.
+ * Returns false if the source is done.
+ */
+static inline
+bool vinternal_adaptor_pull(struct vinternal_IterAdaptor *ad, size_t i)
+{
+	if (ad->in_count[i] > 0)
+		return true;
+
+	const void *span;
+
+	if (vi_next_span(ad->src[i], 0, &span, &ad->in_count[i]) != VE_OK)
+		return false;
+
+	ad->in[i] = span;
+
+	return true;
+}
+
+/**
+ * Produce the next chunk of an adaptor if the last one
+ * has been handed out completely.
+ * Returns false if the adaptor is done.
+ */
+static
+bool vinternal_adaptor_fill(VecIter *iter)
+{
+	struct vinternal_IterAdaptor *ad = iter->adaptor;
+
+	if (ad->out_count > 0)
+		return true;
+
+	const void *span;
+	size_t count;
+
+	switch (ad->kind)
+	{
+		case VINTERNAL_ITER_MAP:
+		{
+			if (vi_next_span(ad->src[0], VINTERNAL_ITER_BATCH, &span, &count) != VE_OK)
+				return false;
+
+			size_t in_size = ad->src[0]->elem_size;
+
+			for (size_t i = 0; i < count; i++)
+			{
+				ad->map(
+					ad->buf + (i * iter->elem_size),
+					((const char *) span) + (i * in_size),
+					ad->ctx);
+			}
+
+			ad->out = ad->buf;
+			ad->out_count = count;
+
+			return true;
+		}
+
+		case VINTERNAL_ITER_FILTER:
+		{
+			size_t size = iter->elem_size;
+
+			// pass through runs of accepted elements without copying them
+			while (vinternal_adaptor_pull(ad, 0))
+			{
+				const char *chunk = ad->in[0];
+				size_t n = ad->in_count[0];
+				size_t start = 0;
+
+				while (start < n && !ad->filter(chunk + (start * size), ad->ctx))
+					start++;
+
+				if (start == n)
+				{
+					ad->in_count[0] = 0;
+					continue;
+				}
+
+				size_t end = start + 1;
+
+				while (end < n && ad->filter(chunk + (end * size), ad->ctx))
+					end++;
+
+				// the element ending the run has already been rejected
+				size_t next = (end < n) ? end + 1 : end;
+
+				ad->in[0] = chunk + (next * size);
+				ad->in_count[0] = n - next;
+
+				ad->out = chunk + (start * size);
+				ad->out_count = end - start;
+
+				return true;
+			}
+
+			return false;
+		}
+
+		case VINTERNAL_ITER_TAKE:
+		{
+			if (ad->left == 0 || vi_next_span(ad->src[0], ad->left, &span, &count) != VE_OK)
+				return false;
+
+			ad->left -= count;
+
+			ad->out = span;
+			ad->out_count = count;
+
+			return true;
+		}
+
+		case VINTERNAL_ITER_ZIP:
+		{
+			if (!vinternal_adaptor_pull(ad, 0) || !vinternal_adaptor_pull(ad, 1))
+				return false;
+
+			size_t a_size = ad->src[0]->elem_size;
+			size_t b_size = ad->src[1]->elem_size;
+
+			count = (ad->in_count[0] < ad->in_count[1]) ? ad->in_count[0] : ad->in_count[1];
+
+			if (count > VINTERNAL_ITER_BATCH)
+				count = VINTERNAL_ITER_BATCH;
+
+			for (size_t i = 0; i < count; i++)
+			{
+				char *pair = ad->buf + (i * iter->elem_size);
+
+				memcpy(pair, ad->in[0] + (i * a_size), a_size);
+				memcpy(pair + a_size, ad->in[1] + (i * b_size), b_size);
+			}
+
+			ad->in[0] += count * a_size;
+			ad->in[1] += count * b_size;
+			ad->in_count[0] -= count;
+			ad->in_count[1] -= count;
+
+			ad->out = ad->buf;
+			ad->out_count = count;
+
+			return true;
+		}
+
+		case VINTERNAL_ITER_CHAIN:
+		{
+			if (vi_next_span(ad->src[0], 0, &span, &count) != VE_OK
+				&& vi_next_span(ad->src[1], 0, &span, &count) != VE_OK)
+			{
+				return false;
+			}
+
+			ad->out = span;
+			ad->out_count = count;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Create an adaptor over one or two source iterators.
+ * Batches are produced into a buffer of buf_elems elements.
+ */
+static
+VecIter *vinternal_adaptor_create(enum vinternal_IterKind kind, VecIter *a, VecIter *b,
+	size_t elem_size, size_t buf_elems)
+{
+	VecIter *iter = malloc(sizeof(VecIter));
+	if (iter == NULL)
+		return NULL;
+
+	struct vinternal_IterAdaptor *ad = calloc(1, sizeof(struct vinternal_IterAdaptor));
+	if (ad == NULL)
+	{
+		free(iter);
+		return NULL;
+	}
+
+	if (buf_elems > 0)
+	{
+		ad->buf = malloc(buf_elems * elem_size);
+		if (ad->buf == NULL)
+		{
+			free(ad);
+			free(iter);
+			return NULL;
+		}
+	}
+
+	ad->kind = kind;
+	ad->src[0] = a;
+	ad->src[1] = b;
+
+	*iter = (VecIter)
+	{
+		.elem_size = elem_size,
+		.step = 1,
+		.adaptor = ad,
+	};
+
+	return iter;
+}
+
+/**
+ * Turn an iterator owning its vector into one sharing the vector's
+ * buffer, so that further iterators can share it as well.
+ */
+static
+int vinternal_iter_share(VecIter *iter)
+{
+	if (!iter->owner)
+		return VE_OK;
+
+	Vec *vec = iter->vec;
+
+	if (vec->data != NULL && vec->shared == NULL)
+	{
+		vec->shared = malloc(sizeof(struct vinternal_Shared));
+		if (vec->shared == NULL)
+			return VE_NOMEM;
+
+		vec->shared->data = vec->data;
+		vec->shared->cap = vec->cap;
+		vec->shared->refs = 1;
+	}
+
+	// the reference of the vector is handed over to the iterator
+	vinternal_iter_sync(iter);
+
+	iter->shared = vec->shared;
+	iter->vec = NULL;
+	iter->owner = false;
+
+	free(vec);
+
+	return VE_OK;
+}
+
+/**
+ * Create an iterator over the positions from pos to end
+ * of another iterator, sharing its elements.
+ * The positions have to be within the range the iterator has left.
+ */
+static
+VecIter *vinternal_iter_sub(VecIter *iter, size_t pos, size_t end)
+{
+	VecIter *sub = malloc(sizeof(VecIter));
+	if (sub == NULL)
+		return NULL;
+
+	*sub = *iter;
+	sub->pos = 0;
+	sub->count = end - pos;
+
+	// rebase, so that resetting the new iterator stays inside of its range
+	if (end > pos)
+	{
+		size_t offset = pos * iter->step;
+
+		sub->from = iter->reverse
+			? iter->from - offset
+			: iter->from + offset;
+	}
+
+	if (sub->shared != NULL)
+		VMACRO_REF_INC(sub->shared->refs);
+
+	return sub;
+}
+
+/**
+ * Copy the elements an iterator has left to a new vector.
+ */
+static
+Vec *vinternal_iter_collect(VecIter *iter)
+{
+	Vec *vec = vinternal_create(iter->elem_size, vinternal_iter_hint(iter));
+	if (vec == NULL)
+		return NULL;
+
+	if (iter->vec != NULL)
+		vec->config = iter->vec->config & ~VINTERNAL_OWNAGE_MASK;
+
+	const void *span;
+	size_t count;
+
+	while (vi_next_span(iter, 0, &span, &count) == VE_OK)
+	{
+		if (v_append(vec, (void *) span, count) != VE_OK)
+		{
+			v_destroy(vec);
+			return NULL;
+		}
+	}
+
+	return vec;
+}
+
+/**
+ * Context of v_parallel_for.
+ */
+struct vinternal_ForCtx
+{
+	char *first;
+	size_t len, elem_size, grain;
+
+	VecRangeFn fn;
+	void *ctx;
+};
+
+static
+void vinternal_for_chunk(void *raw, size_t chunk)
+{
+	struct vinternal_ForCtx *ctx = raw;
+
+	size_t from = chunk * ctx->grain;
+	size_t count = (ctx->len - from < ctx->grain) ? ctx->len - from : ctx->grain;
+
+	ctx->fn(ctx->first + (from * ctx->elem_size), count, from, ctx->ctx);
+}
+
+/**
+ * Context of v_parallel_map.
+ */
+struct vinternal_MapCtx
+{
+	const char *src;
+	char *dst;
+	size_t len, src_size, dst_size, grain;
+
+	VecMapFn fn;
+	void *ctx;
+};
+
+static
+void vinternal_map_chunk(void *raw, size_t chunk)
+{
+	struct vinternal_MapCtx *ctx = raw;
+
+	size_t from = chunk * ctx->grain;
+	size_t to = (ctx->len - from < ctx->grain) ? ctx->len : from + ctx->grain;
+
+	const char *src = ctx->src + (from * ctx->src_size);
+	char *dst = ctx->dst + (from * ctx->dst_size);
+
+	for (size_t i = from; i < to; i++, src += ctx->src_size, dst += ctx->dst_size)
+		ctx->fn(dst, src, ctx->ctx);
+}
+
+/**
+ * Vectors shorter than this are sorted and merged sequentially,
+ * below it spreading the work costs more than it saves.
+ */
+static const size_t VINTERNAL_PARALLEL_SORT_MIN = 1 << 14;
+
+/**
+ * Find the merge path split of diagonal diag, i.e. the amount of
+ * elements of a among the first diag elements of the merge of a
+ * and b. Equal elements of a come before those of b.
+ */
+static
+size_t vinternal_merge_split(const char *a, size_t a_len, const char *b, size_t b_len,
+	size_t size, VecCmp cmp, size_t diag)
+{
+	size_t lo = (diag > b_len) ? diag - b_len : 0;
+	size_t hi = (diag < a_len) ? diag : a_len;
+
+	while (lo < hi)
+	{
+		size_t mid = lo + ((hi - lo) / 2);
+
+		if (cmp(a + (mid * size), b + ((diag - mid - 1) * size)) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/**
+ * Write the elements from up to to of the merge of a and b to dest.
+ * Ranges of the merge written by different calls are independent.
+ */
+static
+void vinternal_merge_range(char *dest, const char *a, size_t a_len, const char *b, size_t b_len,
+	size_t size, VecCmp cmp, size_t from, size_t to)
+{
+	size_t i = vinternal_merge_split(a, a_len, b, b_len, size, cmp, from);
+	size_t i_end = vinternal_merge_split(a, a_len, b, b_len, size, cmp, to);
+
+	const char *x = a + (i * size), *x_end = a + (i_end * size);
+	const char *y = b + ((from - i) * size), *y_end = b + ((to - i_end) * size);
+
+	dest += from * size;
+
+	while (x != x_end && y != y_end)
+	{
+		if (cmp(y, x) < 0)
+		{
+			vinternal_copy(dest, y, size);
+			y += size;
+		}
+		else
+		{
+			vinternal_copy(dest, x, size);
+			x += size;
+		}
+
+		dest += size;
+	}
+
+	if (x != x_end)
+		memcpy(dest, x, (size_t) (x_end - x));
+	else if (y != y_end)
+		memcpy(dest, y, (size_t) (y_end - y));
+}
+
+/**
+ * Context of a parallel sort. Each of the run_count runs of run_len
+ * elements is sorted on its own, then pairs of runs of width elements
+ * are merged from src to dest, until a single run is left.
+ */
+struct vinternal_SortCtx
+{
+	char *base;
+	size_t len, elem_size;
+	VecCmp cmp;
+
+	size_t run_len, run_count;
+
+	const char *src;
+	char *dest;
+	size_t width, chunks_per_pair, grain;
+};
+
+static
+void vinternal_sort_run(void *raw, size_t run)
+{
+	struct vinternal_SortCtx *ctx = raw;
+
+	size_t from = run * ctx->run_len;
+	size_t len = (ctx->len - from < ctx->run_len) ? ctx->len - from : ctx->run_len;
+
+	vinternal_sort(ctx->base + (from * ctx->elem_size), len, ctx->elem_size,
+		ctx->cmp, vinternal_depth_limit(len));
+}
+
+static
+void vinternal_sort_merge_chunk(void *raw, size_t chunk)
+{
+	struct vinternal_SortCtx *ctx = raw;
+
+	size_t pair = chunk / ctx->chunks_per_pair;
+	size_t start = pair * 2 * ctx->width;
+	size_t from = (chunk % ctx->chunks_per_pair) * ctx->grain;
+
+	size_t a_len = (ctx->len - start < ctx->width) ? ctx->len - start : ctx->width;
+	size_t b_len = (ctx->len - start - a_len < ctx->width) ? ctx->len - start - a_len : ctx->width;
+
+	if (from >= a_len + b_len)
+		return;
+
+	size_t to = (a_len + b_len - from < ctx->grain) ? a_len + b_len : from + ctx->grain;
+	size_t offset = start * ctx->elem_size;
+
+	vinternal_merge_range(ctx->dest + offset, ctx->src + offset, a_len,
+		ctx->src + offset + (a_len * ctx->elem_size), b_len,
+		ctx->elem_size, ctx->cmp, from, to);
+}
+
+/**
+ * Context of v_merge_parallel.
+ */
+struct vinternal_MergeCtx
+{
+	char *dest;
+	const char *a, *b;
+	size_t a_len, b_len, elem_size, grain;
+	VecCmp cmp;
+};
+
+static
+void vinternal_merge_chunk(void *raw, size_t chunk)
+{
+	struct vinternal_MergeCtx *ctx = raw;
+
+	size_t len = ctx->a_len + ctx->b_len;
+	size_t from = chunk * ctx->grain;
+	size_t to = (len - from < ctx->grain) ? len : from + ctx->grain;
+
+	vinternal_merge_range(ctx->dest, ctx->a, ctx->a_len, ctx->b, ctx->b_len,
+		ctx->elem_size, ctx->cmp, from, to);
+}
+
+/**
+ * General logging function with timestamp.
+ */
+VMACRO_VERBOSE_MODE(
+static
+void vinternal_log_to_stream(FILE *stream, char *tag, char *msg)
+{
+	time_t current_time_raw = time(NULL);
+	struct tm *current_time = localtime(&current_time_raw);
+	fprintf(stream, "[%d-%d-%d %d:%d:%d] [%s] : %s\n",
+		current_time->tm_year,
+		current_time->tm_mon,
+		current_time->tm_mday,
+
+		current_time->tm_hour,
+		current_time->tm_min,
+		current_time->tm_sec,
+
+		tag, msg);
+})
+/**
+ * Log to vinternal_out_stream.
+ * Only logs in verbose mode.
+ */
+VMACRO_VERBOSE_MODE(
+static inline
+void vinternal_log(char *tag, char *msg)
+{
+	vinternal_log_to_stream(
+		vinternal_get_out_stream(),
+		tag, msg);
+})
+/**
+ * Log to vinternal_err_stream.
+ * Only logs in verbose mode.
+ */
+VMACRO_VERBOSE_MODE(
+static inline
+void vinternal_err(char *tag, char *msg)
+{
+	vinternal_log_to_stream(
+		vinternal_get_err_stream(),
+		tag, msg);
+})
+
+
+// Implementations functions exposed to user ; doc in vector.h
+
+void vc_set_base_cfg(enum VecCfg config)
+{
+	VMACRO_STORE(vinternal_base_cfg, (uint16_t) (config & ~VINTERNAL_OWNAGE_MASK));
+}
+
+void vc_set_base_cap(size_t base_cap)
+{
+	VMACRO_STORE(vinternal_base_cap, base_cap);
+}
+
+void vc_set_output_stream(FILE *stream)
+{
+	VMACRO_STORE(vinternal_out_stream, stream);
+}
+
+void vc_set_error_stream(FILE *stream)
+{
+	VMACRO_STORE(vinternal_err_stream, stream);
+}
+
+void vc_set_thread_count(size_t count)
+{
+	// store first, so that a pool restarted meanwhile uses the new count
+	VMACRO_STORE(vinternal_thread_count, count);
+
+	vinternal_pool_stop();
+}
+
+int vc_push_defaults(enum VecCfg config, size_t base_cap)
+{
+	if (vinternal_defaults_depth == VINTERNAL_DEFAULTS_DEPTH)
+		return VE_NOCAP;
+
+	vinternal_defaults[vinternal_defaults_depth].cfg = config & ~VINTERNAL_OWNAGE_MASK;
+	vinternal_defaults[vinternal_defaults_depth].cap = base_cap;
+
+	vinternal_defaults_depth++;
+
+	return VE_OK;
+}
+
+int vc_pop_defaults(void)
+{
+	if (vinternal_defaults_depth == 0)
+		return VE_EMPTY;
+
+	vinternal_defaults_depth--;
+
+	return VE_OK;
+}
+
+
+void v_perror(const char *str, enum VecErr err)
+{
+	const char *colon;
+
+	if (str == NULL || *str == '\0')
+		str = colon = "";
+	else
+		colon = ": ";
+
+	if (err < 0 || err >= VINTERNAL_LAST)
+		err = VINTERNAL_LAST;
+
+	fprintf(
+		vinternal_get_err_stream(),
+		"%s%s%s\n",
+		str, colon, VINTERNAL_ERROR_STRINGS[err]);
+}
+
+
+Vec *v_create(size_t elem_size)
+{
+	return vinternal_create(elem_size, vinternal_get_base_cap());
+}
+
+Vec *v_create_with(size_t elem_size, size_t base_cap)
+{
+	return vinternal_create(elem_size, base_cap);
+}
 
 
 int v_set_cfg(Vec *vec, enum VecCfg config)
@@ -506,877 +3539,2696 @@ int v_set_cfg(Vec *vec, enum VecCfg config)
 	if (vec == NULL)
 		return VE_INVAL;
 
-	vec->config = (config & ~VINTERNAL_OWNAGE_MASK);
+	vec->config = (config & ~VINTERNAL_OWNAGE_MASK);
+
+	return VE_OK;
+}
+
+int v_add_cfg(Vec *vec, enum VecCfg config)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	vec->config |= (config & ~VINTERNAL_OWNAGE_MASK);
+
+	return VE_OK;
+}
+
+int v_remove_cfg(Vec *vec, enum VecCfg config)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	vec->config &= ~(config & ~VINTERNAL_OWNAGE_MASK);
+
+	return VE_OK;
+}
+
+
+size_t v_elem_size(Vec *vec)
+{
+	return (vec == NULL) ? 0 : vec->elem_size;
+}
+
+size_t v_len(Vec *vec)
+{
+	return (vec == NULL) ? 0 : vec->len;
+}
+
+size_t v_cap(Vec *vec)
+{
+	return (vec == NULL) ? 0 : vec->cap;
+}
+
+size_t v_offset(Vec *vec)
+{
+	return (vec == NULL) ? 0 : vec->offset;
+}
+
+
+int v_clear(Vec *vec)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	if (!vinternal_drop_shared(vec))
+		free(vec->data);
+
+	vinternal_release(vec);
+
+	return VE_OK;
+}
+
+
+int v_set_size(Vec *vec, size_t size)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (size < vec->len)
+		return VE_TOOLONG;
+
+	return vinternal_set_size(vec, size, vinternal_c_keepoffset(vec), false);
+}
+
+int v_reduce(Vec *vec)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	return vinternal_set_size(vec, vec->len, vinternal_c_keepoffset(vec), false);
+}
+
+int v_reduce_strict(Vec *vec) // remove???
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	return vinternal_set_size(vec, vec->len, false, false);
+}
+
+int v_grow(Vec *vec, size_t by_size)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	size_t new_cap = vinternal_size_t_add(vinternal_real_cap(vec), by_size);
+
+	return vinternal_set_size(vec, new_cap, vinternal_c_keepoffset(vec), true);
+}
+
+int v_shrink(Vec *vec, size_t by_size)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	size_t new_cap = vinternal_size_t_sub(vinternal_real_cap(vec), by_size);
+
+	if (new_cap < vec->len)
+		return VE_TOOLONG;
+
+	return vinternal_set_size(vec, new_cap, vinternal_c_keepoffset(vec), false);
+}
+
+
+int v_push(Vec *vec, void *elem)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (elem == NULL)
+		return VE_OK;
+
+	size_t new_len = vec->len + 1;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_grow_maybe(vec, new_len, vinternal_c_keepoffset(vec)));
+
+	vec->len = new_len;
+
+	memcpy(
+		vec->last,
+		elem,
+		vec->elem_size);
+
+	vec->last = ((char *) vec->last) + vec->elem_size;
+
+	return VE_OK;
+}
+
+int v_pop(Vec *vec, void *dest)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (vec->len == 0)
+		return VE_EMPTY;
+
+	vec->last = ((char*) vec->last) - vec->elem_size;
+	vec->len--;
+
+	if (dest != NULL)
+	{
+		memcpy(
+			dest,
+			vec->last,
+			vec->elem_size);
+	}
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_shrink_maybe(vec));
+
+	return VE_OK;
+}
+
+
+int v_first(Vec *vec, void *dest)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	if (vec->len == 0)
+		return VE_EMPTY;
+
+	if (dest == NULL)
+		return VE_OK;
+
+	memcpy(
+		dest,
+		vec->first,
+		vec->elem_size);
+
+	return VE_OK;
+}
+
+int v_last(Vec *vec, void *dest)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	if (vec->len == 0)
+		return VE_EMPTY;
+
+	if (dest == NULL)
+		return VE_OK;
+
+	memcpy(
+		dest,
+		((char *) vec->last - vec->elem_size),
+		vec->elem_size);
+
+	return VE_OK;
+}
+
+
+int v_at(Vec *vec, void *dest, size_t index)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	if (vec->len == 0)
+		return VE_EMPTY;
+
+	if (index > vec->len)
+	{
+		if (vinternal_c_allowoutofbounds(vec))
+			return VE_OUTOFBOUNDS;
+
+		return v_last(vec, dest);
+	}
+
+	if (dest == NULL)
+		return VE_OK;
+
+	memcpy(
+		dest,
+		((char *) vec->first) + index * vec->elem_size,
+		vec->elem_size);
+
+	return VE_OK;
+}
+
+int v_insert(Vec *vec, void *elem, size_t index)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (elem == NULL)
+		return VE_OK;
+
+	size_t index_plus_one = index + 1;
+
+	size_t size_til_index = index * vec->elem_size;
+
+	if (index >= vec->len)
+	{
+		if (!vinternal_c_allowoutofbounds(vec))
+			return v_push(vec, elem);
+
+		VMACRO_RETURN_MAYBE(
+			vinternal_grow_maybe(vec, index_plus_one, vinternal_c_keepoffset(vec)));
+
+		if (vec->len == 0)
+		{
+			vec->first = ((char *) vec->data) + (vec->offset * vec->elem_size);
+		}
+
+		memset(
+			((char *) vec->last),
+			0,
+			(index - vec->len) * vec->elem_size);
+
+		vec->last = ((char *) memcpy(
+			((char *) vec->first) + size_til_index,
+			elem,
+			vec->elem_size))
+			+ vec->elem_size;
+
+		vec->len = index_plus_one;
+
+		return VE_OK;
+	}
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_open_gap(vec, index, 1));
+
+	memcpy(
+		((char *) vec->first) + size_til_index,
+		elem,
+		vec->elem_size);
+
+	return VE_OK;
+}
+
+int v_remove(Vec *vec, void *dest, size_t index)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (vec->len == 0)
+		return VE_EMPTY;
+
+	if (index >= vec->len)
+	{
+		if (vinternal_c_allowoutofbounds(vec))
+			return VE_OUTOFBOUNDS;
+
+		return v_pop(vec, dest);
+	}
+
+	if (dest != NULL)
+	{
+		memcpy(
+			dest,
+			((char *) vec->first) + (index * vec->elem_size),
+			vec->elem_size);
+	}
+
+	vinternal_close_gap(vec, index, 1);
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_shrink_maybe(vec));
+
+	return VE_OK;
+}
+
+
+int v_swap_insert(Vec *vec, void *elem, size_t index)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (elem == NULL)
+		return VE_OK;
+
+	if (index >= vec->len)
+		return v_insert(vec, elem, index);
+
+	VMACRO_RETURN_MAYBE(
+		v_push(vec, ((char *) vec->first) + (index * vec->elem_size)));
+
+	memcpy(
+		((char *) vec->first) + (index * vec->elem_size),
+		elem,
+		vec->elem_size);
+
+	return VE_OK;
+}
+
+int v_swap_remove(Vec *vec, void *dest, size_t index)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (vec->len == 0)
+		return VE_EMPTY;
+
+	if (index >= vec->len)
+	{
+		if (vinternal_c_allowoutofbounds(vec))
+			return VE_OUTOFBOUNDS;
+
+		return v_pop(vec, dest);
+	}
+
+	void *removed = ((char *)vec->first) + (index * vec->elem_size);
+
+	if (dest != NULL)
+	{
+		memcpy(
+			dest,
+			removed,
+			vec->elem_size);
+	}
+
+	VMACRO_RETURN_MAYBE(
+		v_pop(vec, removed));
+
+	return VE_OK;
+}
+
+
+void *v_raw(Vec *vec)
+{
+	if (vec == NULL)
+		return NULL;
+
+	if (vec->len == 0)
+		return NULL;
+
+	if (vinternal_c_rawnocopy(vec))
+	{
+		// the caller may write through the pointer
+		if (vinternal_unshare(vec) != VE_OK)
+			return NULL;
+
+		return vec->first;
+	}
+
+	size_t raw_size = vec->len * vec->elem_size;
+
+	void *raw = malloc(raw_size);
+	if (raw == NULL)
+		return NULL;
+
+	return memcpy(
+			raw,
+			vec->first,
+			raw_size);
+}
+
+void *v_raw_slice(Vec *vec, size_t from, size_t to)
+{
+	if (vec == NULL)
+		return NULL;
+
+	if (vec->len == 0)
+		return NULL;
+
+	if (from >= to)
+		return NULL;
+
+	if (from >= vec->len)
+		return NULL;
+
+	if (to >= vec->len)
+		to = vec->len - 1;
+
+
+	if (vinternal_c_rawnocopy(vec))
+	{
+		if (vinternal_unshare(vec) != VE_OK)
+			return NULL;
+
+		return ((char *) vec->first) + (from * vec->elem_size);
+	}
+
+	size_t raw_slice_size = (to - from) * vec->elem_size;
+
+	void *raw_slice = malloc(raw_slice_size);
+	if (raw_slice == NULL)
+		return NULL;
+
+	return memcpy(
+			raw_slice,
+			((char *) vec->first) + (from * vec->elem_size),
+			raw_slice_size);
+}
+
+
+VecView v_view(Vec *vec)
+{
+	if (vec == NULL)
+		return (VecView) {0};
+
+	return (VecView)
+	{
+		.data = vec->first,
+		.len = vec->len,
+		.elem_size = vec->elem_size,
+	};
+}
+
+VecView v_view_slice(Vec *vec, size_t from, size_t to)
+{
+	return vv_slice(v_view(vec), from, to);
+}
+
+VecView vv_slice(VecView view, size_t from, size_t to)
+{
+	if (to > view.len)
+		to = view.len;
+
+	if (from > to)
+		from = to;
+
+	if (to > from)
+		view.data = ((const char *) view.data) + (from * view.elem_size);
+
+	view.len = to - from;
+
+	return view;
+}
+
+const void *vv_at(VecView view, size_t index)
+{
+	if (index >= view.len)
+		return NULL;
+
+	return ((const char *) view.data) + (index * view.elem_size);
+}
+
+
+Vec *v_slice(Vec *vec, size_t from, size_t to)
+{
+	if (vec == NULL)
+		return NULL;
+
+	if (vec->len == 0)
+		return NULL;
+
+	if (from >= to)
+		return NULL;
+
+	if (from >= vec->len)
+		return NULL;
+
+	if (to >= vec->len)
+		to = vec->len - 1;
+
+	return vinternal_clone(vec, from, to, true);
+}
+
+int v_prepend(Vec *vec, void *src, size_t amount)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (src == NULL || amount == 0) // implement src == NULL as special case and prepend zeroes?
+		return VE_OK;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_grow_front_maybe(vec, amount));
+
+	vec->offset -= amount;
+	vec->first = memcpy(
+		((char *) vec->data) + (vec->offset * vec->elem_size),
+		src,
+		amount * vec->elem_size);
+
+	vec->len += amount;
+	vec->last = ((char *) vec->first) + (vec->len * vec->elem_size);
+
+	return VE_OK;
+}
+// rework later?
+int v_append(Vec *vec, void *src, size_t amount)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (src == NULL || amount == 0)
+		return VE_OK;
+
+	size_t new_len = vec->len + amount;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_grow_maybe(vec, new_len, true));
+
+	if (vec->len == 0)
+	{
+		vec->first = ((char *)vec->data) + (vec->offset * vec->elem_size);
+		vec->last = vec->first;
+	}
+
+	vec->len = new_len;
+
+	size_t new_size = amount * vec->elem_size;
+
+	vinternal_bulk_copy(
+		vec->last,
+		src,
+		new_size,
+		vinternal_c_parallelcopy(vec));
+
+	vec->last = ((char *)vec->last) + new_size;
+
+	return VE_OK;
+}
+
+Vec *v_concat(Vec **vecs, size_t n, bool adopt)
+{
+	if (vecs == NULL || n == 0 || vecs[0] == NULL)
+		return NULL;
+
+	size_t total = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (vecs[i] == NULL)
+			return NULL;
+
+		total = vinternal_size_t_add(total, vecs[i]->len);
+	}
+
+	if (total > ((size_t) SIZE_MAX) / vecs[0]->elem_size)
+		return NULL;
+
+	// the result only gets a buffer of its own if no part donates one
+	Vec *vec = vinternal_create(vecs[0]->elem_size, adopt ? 0 : total);
+	if (vec == NULL)
+		return NULL;
+
+	if (vinternal_concat(vec, vecs, n, adopt) != VE_OK)
+	{
+		v_destroy(vec);
+		return NULL;
+	}
+
+	return vec;
+}
+
+int v_extend_many(Vec *dest, Vec **srcs, size_t n, bool adopt)
+{
+	if (dest == NULL || (srcs == NULL && n > 0))
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(dest));
+
+	return vinternal_concat(dest, srcs, n, adopt);
+}
+
+
+int v_trim_front(Vec *vec, void *dest, size_t amount)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (amount > vec->len)
+		amount = vec->len;
+
+	size_t trim_size = amount * vec->elem_size;
+
+	if (dest != NULL)
+	{
+		memcpy(
+			dest,
+			vec->first,
+			trim_size);
+	}
+
+	vec->first = ((char *) vec->first) + trim_size;
+	vec->offset += amount;
+	vec->len -= amount;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_shrink_maybe(vec));
+
+	return VE_OK;
+}
+
+int v_trim_back(Vec *vec, void *dest, size_t amount)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (amount > vec->len)
+		amount = vec->len;
+
+	size_t trim_size = amount * vec->elem_size;
+	vec->last = ((char *) vec->last) - trim_size;
+
+	if (dest != NULL)
+	{
+		memcpy(
+			dest,
+			vec->last,
+			trim_size);
+	}
+
+	vec->len -= amount;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_shrink_maybe(vec));
+
+	return VE_OK;
+}
+// TODO: implement insert as insert_multiple with amount=1?
+// do trim_front and trim_back make sense as separate funcs?
+// -> can save a lot of oob checks bc conditions are guaranteed
+// -> are special cases sufficiently frequent? (probably yes)
+int v_insert_multiple(Vec *vec, void *src, size_t index, size_t amount)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (index == 0)
+		return v_prepend(vec, src, amount);
+
+	if (src == NULL)
+		return VE_OK;
+
+	size_t index_plus_amount = index + amount;
+
+	size_t insert_size = amount * vec->elem_size;
+	size_t size_til_index = index * vec->elem_size;
+
+	if (index >= vec->len)
+	{
+		if (!vinternal_c_allowoutofbounds(vec))
+			return v_append(vec, src, amount);
+
+		VMACRO_RETURN_MAYBE(
+			vinternal_grow_maybe(vec, index_plus_amount, vinternal_c_keepoffset(vec)));
+
+		if (vec->len == 0)
+		{
+			vec->first = ((char *) vec->data) + (vec->offset * vec->elem_size);
+		}
+
+		memset(
+			((char *) vec->last),
+			0,
+			(index - vec->len) * vec->elem_size);
+
+		vec->last = ((char *) memcpy(
+			((char *) vec->first) + size_til_index,
+			src,
+			insert_size))
+			+ insert_size;
+
+		vec->len = index_plus_amount;
+
+		return VE_OK;
+	}
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_open_gap(vec, index, amount));
+
+	memcpy(
+		((char *) vec->first) + size_til_index,
+		src,
+		insert_size);
+
+	return VE_OK;
+}
+
+int v_remove_multiple(Vec *vec, void *dest, size_t index, size_t amount)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (vec->len == 0)
+		return VE_EMPTY;
+
+	if (index == 0)
+		return v_trim_front(vec, dest, amount);
+
+	if (index >= vec->len)
+	{
+		if (vinternal_c_allowoutofbounds(vec))
+			return VE_OUTOFBOUNDS;
+
+		return v_trim_back(vec, dest, amount);
+	}
+
+	if (amount > vec->len - index)
+		amount = vec->len - index;
+
+	if (dest != NULL)
+	{
+		memcpy(
+			dest,
+			((char *) vec->first) + (index * vec->elem_size),
+			amount * vec->elem_size);
+	}
+
+	vinternal_close_gap(vec, index, amount);
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_shrink_maybe(vec));
+
+	return VE_OK;
+}
+
+
+Vec *v_split(Vec *vec, size_t index)
+{
+	if (vec == NULL)
+		return NULL;
+
+	if (index > vec->len)
+		return vinternal_c_allowoutofbounds(vec)
+			? NULL
+			: vinternal_create(vec->elem_size, 0);
+
+	if (vinternal_unshare(vec) != VE_OK)
+		return NULL;
+
+	Vec *higher = vinternal_clone(vec, index, vec->len, true);
+	if (higher == NULL)
+		return NULL;
+
+	vec->len = index;
+	vec->last = ((char *) vec->first) + (index * vec->elem_size);
+
+	vinternal_shrink_maybe(vec); // check retval? vinternal_set_size doesn't corrupt vec on failure
+
+	return higher;
+}
+
+Vec *v_clone(Vec *vec)
+{
+	if (vec == NULL)
+		return NULL;
+
+	return vinternal_clone(vec, 0, vec->len, false);
+}
+
+Vec *v_reduced_clone(Vec *vec)
+{
+	if (vec == NULL)
+		return NULL;
+
+	return vinternal_clone(vec, 0, vec->len, true);
+}
+
+
+int v_swap(Vec *a, Vec *b)
+{
+	if (a == NULL || b == NULL)
+		return VE_INVAL;
+
+	if (vinternal_owned(a) || vinternal_owned(b))
+		return VE_INVAL;
+
+	// both vectors keep their own config
+	uint16_t a_config = a->config;
+	uint16_t b_config = b->config;
+
+	Vec tmp = *a;
+	*a = *b;
+	*b = tmp;
+
+	a->config = a_config;
+	b->config = b_config;
+
+	return VE_OK;
+}
+
+Vec *v_take(Vec *vec)
+{
+	if (vec == NULL || vinternal_owned(vec))
+		return NULL;
+
+	Vec *taken = malloc(sizeof(Vec));
+	if (taken == NULL)
+		return NULL;
+
+	*taken = *vec;
+
+	vinternal_release(vec);
+
+	return taken;
+}
+
+void *v_into_raw(Vec *vec, size_t *len)
+{
+	if (vec == NULL || vinternal_owned(vec))
+		return NULL;
+
+	if (vinternal_unshare(vec) != VE_OK)
+		return NULL;
+
+	if (vec->offset > 0)
+		vinternal_zero_offset_maybe(vec, vec->cap);
+
+	void *raw = vec->data;
+
+	if (len != NULL)
+		*len = vec->len;
+
+	vinternal_release(vec);
+
+	return raw;
+}
+
+Vec *v_from_raw(void *ptr, size_t len, size_t cap, size_t elem_size)
+{
+	if (elem_size == 0 || len > cap || (ptr == NULL && cap > 0))
+		return NULL;
+
+	Vec *vec = vinternal_create(elem_size, 0);
+	if (vec == NULL)
+		return NULL;
+
+	vec->data = vec->first = ptr;
+	vec->len = len;
+	vec->cap = cap;
+	vec->last = ((char *) vec->first) + (len * elem_size);
+
+	return vec;
+}
+
+
+int v_zero(Vec *vec)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	memset(vec->first, 0, (vec->len * vec->elem_size));
+
+	return VE_OK;
+}
+
+int v_fill(Vec *vec, void *elem, size_t from, size_t to)
+{
+	if (vec == NULL || elem == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (to > vec->len)
+	{
+		if (vinternal_c_allowoutofbounds(vec))
+			return VE_OUTOFBOUNDS;
+
+		to = vec->len;
+	}
+
+	if (from >= to)
+		return VE_OK;
+
+	vinternal_fill(
+		((char *) vec->first) + (from * vec->elem_size),
+		elem,
+		vec->elem_size,
+		to - from);
+
+	return VE_OK;
+}
+
+int v_resize_zeroed(Vec *vec, size_t len)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (len <= vec->len)
+		return v_trim_back(vec, NULL, vec->len - len);
+
+	size_t old_size = vec->len * vec->elem_size;
+	size_t zero_size = (len - vec->len) * vec->elem_size;
+
+	// fresh pages from calloc are already zeroed, so copying the
+	// old elements over beats zeroing a larger extension
+	if (vec->cap - vec->offset < len && zero_size >= VINTERNAL_CALLOC_MIN
+		&& zero_size > old_size && !vinternal_c_keepoffset(vec))
+	{
+		if (vinternal_c_noautogrow(vec))
+			return VE_NOCAP;
+
+		size_t new_cap = vec->cap;
+
+		while (len > new_cap)
+			new_cap = vinternal_size_t_double(new_cap);
+
+		void *new_data = calloc(new_cap, vec->elem_size);
+
+		if (new_data == NULL)
+			return VE_NOMEM;
+
+		if (old_size > 0)
+			memcpy(new_data, vec->first, old_size);
+
+		free(vec->data);
+
+		vec->data = vec->first = new_data;
+		vec->cap = new_cap;
+		vec->offset = 0;
+	}
+	else
+	{
+		VMACRO_RETURN_MAYBE(
+			vinternal_grow_maybe(vec, len, vinternal_c_keepoffset(vec)));
+
+		memset(vec->last, 0, zero_size);
+	}
+
+	vec->len = len;
+	vec->last = ((char *) vec->first) + (len * vec->elem_size);
+
+	return VE_OK;
+}
+
+int v_reverse(Vec *vec)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	vinternal_reverse(vec->first, vec->len, vec->elem_size);
+
+	return VE_OK;
+}
+
+int v_rotate(Vec *vec, size_t k)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (vec->len == 0)
+		return VE_OK;
+
+	k %= vec->len;
+
+	if (k == 0)
+		return VE_OK;
+
+	size_t rest = vec->len - k;
+	size_t size = vec->elem_size;
+
+	// move the shorter part around the other one if there is room for it
+	if (k <= rest && vec->cap - vec->offset - vec->len >= k)
+	{
+		memcpy(vec->last, vec->first, k * size);
+
+		vec->first = ((char *) vec->first) + (k * size);
+		vec->last = ((char *) vec->last) + (k * size);
+		vec->offset += k;
+
+		return VE_OK;
+	}
+
+	if (rest < k && vec->offset >= rest)
+	{
+		vec->first = ((char *) vec->first) - (rest * size);
+		vec->last = ((char *) vec->last) - (rest * size);
+		vec->offset -= rest;
+
+		memcpy(vec->first, vec->last, rest * size);
+
+		return VE_OK;
+	}
+
+	vinternal_rotate(vec->first, k * size, rest * size);
+
+	return VE_OK;
+}
+
+int v_swap_ranges(Vec *vec, size_t a, size_t b, size_t amount)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (a > b)
+	{
+		size_t tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	if (amount > vec->len || b > vec->len - amount)
+		return VE_OUTOFBOUNDS;
+
+	if (a + amount > b)
+		return VE_INVAL;
+
+	vinternal_swap(
+		((char *) vec->first) + (a * vec->elem_size),
+		((char *) vec->first) + (b * vec->elem_size),
+		amount * vec->elem_size);
+
+	return VE_OK;
+}
+
+int v_softclear(Vec *vec)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	// elements shared with snapshots are left to them instead of copied
+	vinternal_drop_shared(vec);
+
+	vec->len = 0;
+
+	if (!vinternal_c_keepoffset(vec))
+	{
+		vec->offset = 0;
+		vec->first = vec->data;
+	}
+
+	vec->last = vec->first;
+
+	return VE_OK;
+}
+
+int v_destroy(Vec *vec)
+{
+	if (vec == NULL)
+		return VE_INVAL;
+
+	if (!vinternal_drop_shared(vec))
+		free(vec->data);
+
+	free(vec);
+
+	return VE_OK;
+}
+
+int v_nth_element(Vec *vec, size_t n, VecCmp cmp)
+{
+	if (vec == NULL || cmp == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (vec->len == 0)
+		return VE_EMPTY;
+
+	if (n >= vec->len)
+		return VE_OUTOFBOUNDS;
+
+	vinternal_select(vec->first, vec->len, n, vec->elem_size, cmp);
+
+	return VE_OK;
+}
+
+int v_nth_element_num(Vec *vec, size_t n, enum VecNum type)
+{
+	if (vec == NULL || !vinternal_num_valid(vec, type))
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (vec->len == 0)
+		return VE_EMPTY;
+
+	if (n >= vec->len)
+		return VE_OUTOFBOUNDS;
+
+	switch (type)
+	{
+		case VN_INT32:
+			vinternal_select_i32(vec->first, vec->len, n);
+			break;
+		case VN_INT64:
+			vinternal_select_i64(vec->first, vec->len, n);
+			break;
+		case VN_UINT32:
+			vinternal_select_u32(vec->first, vec->len, n);
+			break;
+		case VN_UINT64:
+			vinternal_select_u64(vec->first, vec->len, n);
+			break;
+		case VN_FLOAT:
+			vinternal_select_f32(vec->first, vec->len, n);
+			break;
+		case VN_DOUBLE:
+			vinternal_select_f64(vec->first, vec->len, n);
+			break;
+		default:
+			return VE_INVAL;
+	}
+
+	return VE_OK;
+}
+
+int v_partial_sort(Vec *vec, size_t k, VecCmp cmp)
+{
+	if (vec == NULL || cmp == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (k > vec->len)
+		k = vec->len;
+
+	if (k == 0)
+		return VE_OK;
+
+	// heap select only pays off while the heap stays small
+	if (k < (vec->len >> 3))
+	{
+		vinternal_heap_select(vec->first, vec->len, k, vec->elem_size, cmp, false);
+		vinternal_heap_sort(vec->first, k, vec->elem_size, cmp, false);
+
+		return VE_OK;
+	}
+
+	if (k < vec->len)
+		vinternal_select(vec->first, vec->len, k - 1, vec->elem_size, cmp);
+
+	vinternal_sort(vec->first, k, vec->elem_size, cmp, vinternal_depth_limit(k));
+
+	return VE_OK;
+}
+
+int v_top_k(Vec *vec, size_t k, VecCmp cmp, Vec *out)
+{
+	if (vec == NULL || cmp == NULL || out == NULL || vec == out)
+		return VE_INVAL;
+
+	if (out->elem_size != vec->elem_size)
+		return VE_INVAL;
+
+	if (k > vec->len)
+		k = vec->len;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_prepare_out(out, k));
+
+	if (k == 0)
+		return VE_OK;
+
+	memcpy(
+		out->first,
+		vec->first,
+		k * vec->elem_size);
+
+	out->len = k;
+	out->last = ((char *) out->first) + (k * out->elem_size);
+
+	// min heap of the k greatest elements seen so far
+	vinternal_heap_make(out->first, k, out->elem_size, cmp, true);
+
+	for (size_t i = k; i < vec->len; i++)
+	{
+		char *cur = ((char *) vec->first) + (i * vec->elem_size);
+
+		if (cmp(cur, out->first) > 0)
+		{
+			memcpy(
+				out->first,
+				cur,
+				out->elem_size);
+
+			vinternal_sift_down(out->first, 0, k, out->elem_size, cmp, true);
+		}
+	}
+
+	vinternal_heap_sort(out->first, k, out->elem_size, cmp, true);
 
 	return VE_OK;
 }
 
-int v_add_cfg(Vec *vec, enum VecCfg config)
+
+int v_heap_make(Vec *vec, VecCmp cmp)
 {
-	if (vec == NULL)
+	if (vec == NULL || cmp == NULL)
 		return VE_INVAL;
 
-	vec->config |= (config & ~VINTERNAL_OWNAGE_MASK);
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (vec->len < 2)
+		return VE_OK;
+
+	unsigned char small[64];
+	void *tmp = (vec->elem_size <= sizeof(small))
+		? small
+		: malloc(vec->elem_size);
+
+	if (tmp == NULL)
+		return VE_NOMEM;
+
+	size_t arity = vinternal_heap_arity(vec);
+
+	for (size_t i = ((vec->len - 2) / arity) + 1; i-- > 0;)
+	{
+		char *cur = ((char *) vec->first) + (i * vec->elem_size);
+
+		memcpy(
+			tmp,
+			cur,
+			vec->elem_size);
+
+		vinternal_heap_hole_down(vec->first, i, vec->len, vec->elem_size, arity, cmp, tmp);
+	}
+
+	if (tmp != small)
+		free(tmp);
 
 	return VE_OK;
 }
 
-int v_remove_cfg(Vec *vec, enum VecCfg config)
+int v_heap_push(Vec *vec, void *elem, VecCmp cmp)
 {
-	if (vec == NULL)
+	if (vec == NULL || cmp == NULL)
 		return VE_INVAL;
 
-	vec->config &= ~(config & ~VINTERNAL_OWNAGE_MASK);
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
 
-	return VE_OK;
-}
+	if (elem == NULL)
+		return VE_OK;
 
+	// elem may point into the vector, which v_push can reallocate
+	unsigned char small[64];
+	void *tmp = (vec->elem_size <= sizeof(small))
+		? small
+		: malloc(vec->elem_size);
 
-size_t v_elem_size(Vec *vec)
-{
-	return (vec == NULL) ? 0 : vec->elem_size;
+	if (tmp == NULL)
+		return VE_NOMEM;
+
+	memcpy(
+		tmp,
+		elem,
+		vec->elem_size);
+
+	int err = v_push(vec, tmp);
+
+	if (err == VE_OK)
+	{
+		vinternal_heap_hole_up(vec->first, vec->len - 1, vec->elem_size,
+			vinternal_heap_arity(vec), cmp, tmp);
+	}
+
+	if (tmp != small)
+		free(tmp);
+
+	return err;
 }
 
-size_t v_len(Vec *vec)
+int v_heap_pop(Vec *vec, void *dest, VecCmp cmp)
 {
-	return (vec == NULL) ? 0 : vec->len;
+	if (vec == NULL || cmp == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (vec->len == 0)
+		return VE_EMPTY;
+
+	if (dest != NULL)
+	{
+		memcpy(
+			dest,
+			vec->first,
+			vec->elem_size);
+	}
+
+	size_t new_len = vec->len - 1;
+
+	// the last element stays in place while the hole moves above it
+	if (new_len > 0)
+	{
+		vinternal_heap_hole_down(vec->first, 0, new_len, vec->elem_size,
+			vinternal_heap_arity(vec), cmp,
+			((char *) vec->first) + (new_len * vec->elem_size));
+	}
+
+	return v_pop(vec, NULL);
 }
 
-size_t v_cap(Vec *vec)
+int v_heap_replace(Vec *vec, void *elem, void *dest, VecCmp cmp)
 {
-	return (vec == NULL) ? 0 : vec->cap;
+	if (vec == NULL || cmp == NULL || elem == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	if (vec->len == 0)
+		return VE_EMPTY;
+
+	// elem may be dest or point into the heap, so read it first
+	unsigned char small[64];
+	void *tmp = (vec->elem_size <= sizeof(small))
+		? small
+		: malloc(vec->elem_size);
+
+	if (tmp == NULL)
+		return VE_NOMEM;
+
+	memcpy(
+		tmp,
+		elem,
+		vec->elem_size);
+
+	if (dest != NULL)
+	{
+		memcpy(
+			dest,
+			vec->first,
+			vec->elem_size);
+	}
+
+	vinternal_heap_hole_down(vec->first, 0, vec->len, vec->elem_size,
+		vinternal_heap_arity(vec), cmp, tmp);
+
+	if (tmp != small)
+		free(tmp);
+
+	return VE_OK;
 }
 
-size_t v_offset(Vec *vec)
+
+int v_merge(Vec *a, Vec *b, VecCmp cmp, Vec *out, bool unique)
 {
-	return (vec == NULL) ? 0 : vec->offset;
-}
+	if (a == NULL || b == NULL || cmp == NULL || out == NULL)
+		return VE_INVAL;
 
+	if (a->elem_size != out->elem_size || b->elem_size != out->elem_size
+		|| out == a || out == b)
+	{
+		return VE_INVAL;
+	}
 
-int v_clear(Vec *vec)
+	VMACRO_RETURN_MAYBE(
+		vinternal_prepare_out(out, vinternal_size_t_add(a->len, b->len)));
+
+	size_t size = out->elem_size;
+	char *x = a->first, *x_end = a->last;
+	char *y = b->first, *y_end = b->last;
+
+	while (x != x_end && y != y_end)
+	{
+		if (cmp(y, x) < 0)
+		{
+			vinternal_merge_emit(out, y, cmp, unique);
+			y += size;
+		}
+		else
+		{
+			vinternal_merge_emit(out, x, cmp, unique);
+			x += size;
+		}
+	}
+
+	for (; x != x_end; x += size)
+		vinternal_merge_emit(out, x, cmp, unique);
+
+	for (; y != y_end; y += size)
+		vinternal_merge_emit(out, y, cmp, unique);
+
+	return VE_OK;
+}
+
+int v_merge_k(Vec **vecs, size_t k, VecCmp cmp, Vec *out, bool unique)
 {
-	if (vec == NULL)
+	if (vecs == NULL || cmp == NULL || out == NULL)
 		return VE_INVAL;
 
-	free(vec->data);
+	size_t total = 0;
 
-	vec->data = vec->first = vec->last = NULL;
-	vec->len = vec->cap = vec->offset = 0;
+	for (size_t i = 0; i < k; i++)
+	{
+		if (vecs[i] == NULL || vecs[i] == out || vecs[i]->elem_size != out->elem_size)
+			return VE_INVAL;
+
+		total = vinternal_size_t_add(total, vecs[i]->len);
+	}
+
+	if (k == 2)
+		return v_merge(vecs[0], vecs[1], cmp, out, unique);
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_prepare_out(out, total));
+
+	if (total == 0)
+		return VE_OK;
+
+	struct vinternal_MergeRun *runs = malloc(k * sizeof(struct vinternal_MergeRun));
+	size_t *tree = malloc(k * sizeof(size_t));
+
+	if (runs == NULL || tree == NULL)
+	{
+		free(runs);
+		free(tree);
+		return VE_NOMEM;
+	}
+
+	for (size_t i = 0; i < k; i++)
+	{
+		runs[i].pos = vecs[i]->first;
+		runs[i].end = vecs[i]->last;
+	}
+
+	size_t size = out->elem_size;
+
+	tree[0] = (k == 1) ? 0 : vinternal_merge_build(tree, 1, k, runs, cmp);
+
+	for (size_t n = 0; n < total; n++)
+	{
+		size_t winner = tree[0];
+
+		vinternal_merge_emit(out, runs[winner].pos, cmp, unique);
+		runs[winner].pos += size;
+
+		// replay the winner's path to the root
+		for (size_t node = (winner + k) >> 1; node > 0; node >>= 1)
+		{
+			if (vinternal_merge_beats(runs, tree[node], winner, cmp))
+			{
+				size_t tmp = tree[node];
+				tree[node] = winner;
+				winner = tmp;
+			}
+		}
+
+		tree[0] = winner;
+	}
+
+	free(runs);
+	free(tree);
 
 	return VE_OK;
 }
 
 
-int v_set_size(Vec *vec, size_t size)
+int v_sum(Vec *vec, enum VecNum type, void *dest)
 {
 	if (vec == NULL)
 		return VE_INVAL;
 
-	if (size < vec->len)
-		return VE_TOOLONG;
+	return vv_sum(v_view(vec), type, dest);
+}
 
-	bool prefer_memmove = (vec->cap - vec->offset > size);
+int v_min(Vec *vec, enum VecNum type, void *dest)
+{
+	return v_minmax(vec, type, dest, NULL);
+}
 
-	return vinternal_set_size(vec, size, vinternal_c_keepoffset(vec), prefer_memmove);
+int v_max(Vec *vec, enum VecNum type, void *dest)
+{
+	return v_minmax(vec, type, NULL, dest);
 }
 
-int v_reduce(Vec *vec)
+int v_minmax(Vec *vec, enum VecNum type, void *min, void *max)
 {
 	if (vec == NULL)
 		return VE_INVAL;
 
-	return vinternal_set_size(vec, vec->len, vinternal_c_keepoffset(vec), false);
+	return vv_minmax(v_view(vec), type, min, max);
 }
 
-int v_reduce_strict(Vec *vec) // remove???
+int v_dot(Vec *a, Vec *b, enum VecNum type, void *dest)
 {
-	if (vec == NULL)
+	if (a == NULL || b == NULL)
 		return VE_INVAL;
 
-	return vinternal_set_size(vec, vec->len, false, false);
+	return vv_dot(v_view(a), v_view(b), type, dest);
 }
 
-int v_grow(Vec *vec, size_t by_size)
+int vv_sum(VecView view, enum VecNum type, void *dest)
 {
-	if (vec == NULL)
+	if (dest == NULL || !vinternal_num_valid_size(view.elem_size, type))
 		return VE_INVAL;
 
-	size_t new_cap = vinternal_size_t_add(vec->cap, by_size);
+	VINTERNAL_NUM_KERNELS[type].sum(view.data, view.len, dest);
 
-	return vinternal_set_size(vec, new_cap, vinternal_c_keepoffset(vec), true);
+	return VE_OK;
 }
 
-int v_shrink(Vec *vec, size_t by_size)
+int vv_min(VecView view, enum VecNum type, void *dest)
 {
-	if (vec == NULL)
+	return vv_minmax(view, type, dest, NULL);
+}
+
+int vv_max(VecView view, enum VecNum type, void *dest)
+{
+	return vv_minmax(view, type, NULL, dest);
+}
+
+int vv_minmax(VecView view, enum VecNum type, void *min, void *max)
+{
+	if (!vinternal_num_valid_size(view.elem_size, type))
 		return VE_INVAL;
 
-	size_t new_cap = vinternal_size_t_sub(vec->cap, by_size);
+	if (view.len == 0)
+		return VE_EMPTY;
 
-	if (new_cap < vec->len)
-		return VE_TOOLONG;
+	VINTERNAL_NUM_KERNELS[type].minmax(view.data, view.len, min, max);
 
-	return vinternal_set_size(vec, new_cap, vinternal_c_keepoffset(vec), false);
+	return VE_OK;
 }
 
-
-int v_push(Vec *vec, void *elem)
+int vv_dot(VecView a, VecView b, enum VecNum type, void *dest)
 {
-	if (vec == NULL)
+	if (dest == NULL)
 		return VE_INVAL;
 
-	if (elem == NULL)
-		return VE_OK;
+	if (!vinternal_num_valid_size(a.elem_size, type) || !vinternal_num_valid_size(b.elem_size, type))
+		return VE_INVAL;
 
-	size_t new_len = vec->len + 1;
+	if (a.len != b.len)
+		return VE_OUTOFBOUNDS;
 
-	VMACRO_RETURN_MAYBE(
-		vinternal_grow_maybe(vec, new_len, vinternal_c_keepoffset(vec)));
+	VINTERNAL_NUM_KERNELS[type].dot(a.data, b.data, a.len, dest);
 
-	vec->len = new_len;
+	return VE_OK;
+}
 
-	memcpy(
-		vec->last,
-		elem,
-		vec->elem_size);
+int v_scale(Vec *vec, enum VecNum type, const void *factor)
+{
+	if (vec == NULL || factor == NULL || !vinternal_num_valid(vec, type))
+		return VE_INVAL;
 
-	vec->last = ((char *) vec->last) + vec->elem_size;
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	VINTERNAL_NUM_KERNELS[type].scale(vec->first, vec->len, factor);
 
 	return VE_OK;
 }
 
-int v_pop(Vec *vec, void *dest)
+int v_add_vec(Vec *dest, Vec *src, enum VecNum type)
 {
-	if (vec == NULL)
+	if (dest == NULL || src == NULL)
 		return VE_INVAL;
 
-	if (vec->len == 0)
-		return VE_EMPTY;
+	if (!vinternal_num_valid(dest, type) || !vinternal_num_valid(src, type))
+		return VE_INVAL;
 
-	vec->last = ((char*) vec->last) - vec->elem_size;
-	vec->len--;
+	if (dest->len != src->len)
+		return VE_OUTOFBOUNDS;
 
-	if (dest != NULL)
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(dest));
+
+	VINTERNAL_NUM_KERNELS[type].add(dest->first, src->first, dest->len);
+
+	return VE_OK;
+}
+
+
+/**
+ * Scans of at least this many bytes are split over the thread pool.
+ */
+static const size_t VINTERNAL_PARALLEL_SCAN_MIN = 1 << 20;
+
+/**
+ * Context of a parallel scan. The input is split into chunks of
+ * grain elements. The first pass stores the sum each chunk adds to
+ * the carry in sums, i.e. the sum after its last segment start if
+ * it has one (has_start), the second one scans every chunk again,
+ * starting with its carry from carries.
+ */
+struct vinternal_ScanCtx
+{
+	const char *src;
+	char *dest;
+	const unsigned char *flags;
+	size_t len, elem_size, grain;
+
+	enum VecNum type;
+	bool inclusive;
+
+	uint64_t *sums, *carries;
+	bool *has_start;
+};
+
+/**
+ * Store the sum of len numeric elements of type in dest, computed
+ * in the element type like the scan kernels do.
+ */
+static
+void vinternal_scan_sum(enum VecNum type, const void *src, size_t len, void *dest)
+{
+	uint64_t wide;
+
+	VINTERNAL_NUM_KERNELS[type].sum(src, len, &wide);
+
+	switch (type)
 	{
-		memcpy(
-			dest,
-			vec->last,
-			vec->elem_size);
+		case VN_INT32:
+		case VN_UINT32:
+		{
+			uint64_t bits;
+			memcpy(&bits, &wide, sizeof(bits));
+
+			uint32_t narrow = (uint32_t) bits;
+			memcpy(dest, &narrow, sizeof(narrow));
+			break;
+		}
+		case VN_FLOAT:
+		{
+			double sum;
+			memcpy(&sum, &wide, sizeof(sum));
+
+			float narrow = (float) sum;
+			memcpy(dest, &narrow, sizeof(narrow));
+			break;
+		}
+		default:
+			memcpy(dest, &wide, sizeof(wide));
+			break;
+	}
+}
+
+static
+void vinternal_scan_sum_chunk(void *raw, size_t chunk)
+{
+	struct vinternal_ScanCtx *ctx = raw;
+
+	size_t from = chunk * ctx->grain;
+	size_t to = (ctx->len - from < ctx->grain) ? ctx->len : from + ctx->grain;
+	size_t start = from;
+
+	ctx->has_start[chunk] = false;
+
+	if (ctx->flags != NULL)
+	{
+		for (size_t i = to; i > from; i--)
+		{
+			if (ctx->flags[i - 1])
+			{
+				start = i - 1;
+				ctx->has_start[chunk] = true;
+				break;
+			}
+		}
 	}
 
-	VMACRO_RETURN_MAYBE(
-		vinternal_shrink_maybe(vec));
+	ctx->sums[chunk] = 0;
 
-	return VE_OK;
+	vinternal_scan_sum(ctx->type, ctx->src + (start * ctx->elem_size), to - start,
+		&ctx->sums[chunk]);
 }
 
+static
+void vinternal_scan_chunk(void *raw, size_t chunk)
+{
+	struct vinternal_ScanCtx *ctx = raw;
+
+	size_t from = chunk * ctx->grain;
+	size_t to = (ctx->len - from < ctx->grain) ? ctx->len : from + ctx->grain;
 
-int v_first(Vec *vec, void *dest)
+	VINTERNAL_NUM_KERNELS[ctx->type].scan(
+		ctx->src + (from * ctx->elem_size),
+		ctx->dest + (from * ctx->elem_size),
+		to - from, &ctx->carries[chunk], ctx->inclusive,
+		(ctx->flags != NULL) ? ctx->flags + from : NULL);
+}
+
+/**
+ * Scan on the thread pool in two passes.
+ * Returns false if there was not enough memory to do so.
+ */
+static
+bool vinternal_scan_parallel(struct vinternal_ScanCtx *ctx)
 {
-	if (vec == NULL)
-		return VE_INVAL;
+	size_t chunk_count = vinternal_chunk_count(ctx->len, ctx->grain);
 
-	if (vec->len == 0)
-		return VE_EMPTY;
+	ctx->sums = malloc(chunk_count * sizeof(uint64_t));
+	ctx->carries = malloc(chunk_count * sizeof(uint64_t));
+	ctx->has_start = malloc(chunk_count * sizeof(bool));
 
-	if (dest == NULL)
-		return VE_OK;
+	if (ctx->sums == NULL || ctx->carries == NULL || ctx->has_start == NULL)
+	{
+		free(ctx->sums);
+		free(ctx->carries);
+		free(ctx->has_start);
 
-	memcpy(
-		dest,
-		vec->first,
-		vec->elem_size);
+		return false;
+	}
 
-	return VE_OK;
-}
+	vinternal_parallel_run(vinternal_scan_sum_chunk, ctx, chunk_count - 1);
 
-int v_last(Vec *vec, void *dest)
-{
-	if (vec == NULL)
-		return VE_INVAL;
+	ctx->carries[0] = 0;
 
-	if (vec->len == 0)
-		return VE_EMPTY;
+	for (size_t i = 1; i < chunk_count; i++)
+	{
+		if (ctx->has_start[i - 1])
+		{
+			ctx->carries[i] = ctx->sums[i - 1];
+		}
+		else
+		{
+			ctx->carries[i] = ctx->carries[i - 1];
+			VINTERNAL_NUM_KERNELS[ctx->type].add(&ctx->carries[i], &ctx->sums[i - 1], 1);
+		}
+	}
 
-	if (dest == NULL)
-		return VE_OK;
+	vinternal_parallel_run(vinternal_scan_chunk, ctx, chunk_count);
 
-	memcpy(
-		dest,
-		((char *) vec->last - vec->elem_size),
-		vec->elem_size);
+	free(ctx->sums);
+	free(ctx->carries);
+	free(ctx->has_start);
 
-	return VE_OK;
+	return true;
 }
 
-
-int v_at(Vec *vec, void *dest, size_t index)
+/**
+ * Shared implementation of the scan functions.
+ */
+static
+int vinternal_scan(Vec *vec, Vec *flags, enum VecNum type, Vec *out, bool inclusive)
 {
-	if (vec == NULL)
+	if (vec == NULL || !vinternal_num_valid(vec, type))
 		return VE_INVAL;
 
-	if (vec->len == 0)
-		return VE_EMPTY;
-
-	if (index > vec->len)
+	if (flags != NULL)
 	{
-		if (vinternal_c_allowoutofbounds(vec))
+		if (flags->elem_size != 1)
+			return VE_INVAL;
+
+		if (flags->len != vec->len)
 			return VE_OUTOFBOUNDS;
+	}
 
-		return v_last(vec, dest);
+	if (out == NULL)
+		out = vec;
+
+	if (out == vec)
+	{
+		VMACRO_RETURN_MAYBE(
+			vinternal_unshare(vec));
 	}
+	else
+	{
+		if (out->elem_size != vec->elem_size || out == flags)
+			return VE_INVAL;
 
-	if (dest == NULL)
-		return VE_OK;
+		VMACRO_RETURN_MAYBE(
+			vinternal_prepare_out(out, vec->len));
 
-	memcpy(
-		dest,
-		((char *) vec->first) + index * vec->elem_size,
-		vec->elem_size);
+		out->len = vec->len;
+		out->last = ((char *) out->first) + (out->len * out->elem_size);
+	}
+
+	if (vec->len * vec->elem_size >= VINTERNAL_PARALLEL_SCAN_MIN && vinternal_threads() > 1)
+	{
+		struct vinternal_ScanCtx ctx =
+		{
+			.src = vec->first,
+			.dest = out->first,
+			.flags = (flags != NULL) ? flags->first : NULL,
+			.len = vec->len,
+			.elem_size = vec->elem_size,
+			.grain = vinternal_grain(0, vec->elem_size),
+			.type = type,
+			.inclusive = inclusive,
+		};
+
+		if (vinternal_scan_parallel(&ctx))
+			return VE_OK;
+	}
+
+	uint64_t carry = 0;
+
+	VINTERNAL_NUM_KERNELS[type].scan(vec->first, out->first, vec->len, &carry,
+		inclusive, (flags != NULL) ? flags->first : NULL);
 
 	return VE_OK;
 }
 
-int v_insert(Vec *vec, void *elem, size_t index)
+int v_inclusive_scan(Vec *vec, enum VecNum type, Vec *out)
 {
-	if (vec == NULL)
+	return vinternal_scan(vec, NULL, type, out, true);
+}
+
+int v_exclusive_scan(Vec *vec, enum VecNum type, Vec *out)
+{
+	return vinternal_scan(vec, NULL, type, out, false);
+}
+
+int v_segmented_scan(Vec *vec, Vec *flags, enum VecNum type, Vec *out, bool inclusive)
+{
+	if (flags == NULL)
 		return VE_INVAL;
 
-	if (elem == NULL)
-		return VE_OK;
+	return vinternal_scan(vec, flags, type, out, inclusive);
+}
 
-	size_t index_plus_one = index + 1;
 
-	if (index >= vinternal_real_cap(vec))
-	{
-		if (!vinternal_c_allowoutofbounds(vec))
-			return v_push(vec, elem);
+int v_gather(Vec *src, Vec *idx, Vec *out)
+{
+	if (src == NULL || idx == NULL || out == NULL)
+		return VE_INVAL;
 
-		VMACRO_RETURN_MAYBE(
-			vinternal_grow_maybe(vec, index_plus_one, vinternal_c_keepoffset(vec)));
+	if (idx->elem_size != sizeof(size_t) || out->elem_size != src->elem_size
+		|| out == src || out == idx)
+	{
+		return VE_INVAL;
 	}
 
-	size_t size_til_index = index * vec->elem_size;
+	VMACRO_RETURN_MAYBE(
+		vinternal_prepare_out(out, idx->len));
 
-	if (index >= vec->len)
+	const size_t *indices = idx->first;
+	size_t size = src->elem_size;
+
+	for (size_t i = 0; i < idx->len; i++)
 	{
-		if (!vinternal_c_allowoutofbounds(vec))
-			return v_push(vec, elem);
+		if (indices[i] >= src->len)
+			return VE_OUTOFBOUNDS;
 
-		if (vec->len == 0)
-		{
-			vec->first = ((char *) vec->data) + (vec->offset * vec->elem_size);
-		}
+		vinternal_copy(out->last, ((char *) src->first) + (indices[i] * size), size);
 
-		memset(
-			((char *) vec->last),
-			0,
-			(index - vec->len) * vec->elem_size);
+		out->last = ((char *) out->last) + size;
+		out->len++;
+	}
 
-		vec->last = ((char *) memcpy(
-			((char *) vec->first) + size_til_index,
-			elem,
-			vec->elem_size))
-			+ vec->elem_size;
+	return VE_OK;
+}
 
-		vec->len = index_plus_one;
+int v_scatter(Vec *dest, Vec *idx, Vec *src)
+{
+	if (dest == NULL || idx == NULL || src == NULL)
+		return VE_INVAL;
 
-		return VE_OK;
+	if (idx->elem_size != sizeof(size_t) || dest->elem_size != src->elem_size
+		|| dest == src || dest == idx)
+	{
+		return VE_INVAL;
 	}
 
-	size_t new_len = vec->len + 1;
-	
-	VMACRO_RETURN_MAYBE(
-		vinternal_grow_maybe(vec, new_len, vinternal_c_keepoffset(vec)));
+	if (idx->len != src->len)
+		return VE_OUTOFBOUNDS;
 
-	memmove(
-		((char *) vec->first) + (index_plus_one * vec->elem_size),
-		((char *) vec->first) + size_til_index,
-		(vec->len - index) * vec->elem_size);
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(dest));
 
-	memcpy(
-		((char *) vec->first) + size_til_index,
-		elem,
-		vec->elem_size);
+	const size_t *indices = idx->first;
+	size_t size = src->elem_size;
 
-	vec->len = new_len;
+	for (size_t i = 0; i < idx->len; i++)
+	{
+		if (indices[i] >= dest->len)
+			return VE_OUTOFBOUNDS;
 
-	vec->last = ((char *) vec->last) + vec->elem_size;
+		vinternal_copy(
+			((char *) dest->first) + (indices[i] * size),
+			((char *) src->first) + (i * size),
+			size);
+	}
 
 	return VE_OK;
 }
 
-int v_remove(Vec *vec, void *dest, size_t index)
+int v_argsort(Vec *vec, VecCmp cmp, Vec *out_idx)
 {
-	if (vec == NULL)
+	if (vec == NULL || cmp == NULL || out_idx == NULL || vec == out_idx)
 		return VE_INVAL;
 
-	if (vec->len == 0)
-		return VE_EMPTY;
+	if (out_idx->elem_size != sizeof(size_t))
+		return VE_INVAL;
 
-	if (index >= vec->len)
-	{
-		if (vinternal_c_allowoutofbounds(vec))
-			return VE_OUTOFBOUNDS;
+	VMACRO_RETURN_MAYBE(
+		vinternal_prepare_out(out_idx, vec->len));
 
-		return v_pop(vec, dest);
-	}
+	size_t *indices = out_idx->first;
 
-	if (dest != NULL)
-	{
-		memcpy(
-			dest,
-			((char *) vec->first) + (index * vec->elem_size),
-			vec->elem_size);
-	}
+	for (size_t i = 0; i < vec->len; i++)
+		indices[i] = i;
 
-	memmove(
-		((char *) vec->first) + (index * vec->elem_size),
-		((char *) vec->first) + ((index + 1) * vec->elem_size),
-		(vec->len - index) * vec->elem_size);
+	out_idx->len = vec->len;
+	out_idx->last = indices + vec->len;
 
-	vec->len--;
+	// keep the context of a v_argsort called from inside of cmp
+	const char *prev_base = vinternal_arg_ctx.base;
+	size_t prev_size = vinternal_arg_ctx.size;
+	VecCmp prev_cmp = vinternal_arg_ctx.cmp;
 
-	vec->last = ((char *) vec->last) - vec->elem_size;
+	vinternal_arg_ctx.base = vec->first;
+	vinternal_arg_ctx.size = vec->elem_size;
+	vinternal_arg_ctx.cmp = cmp;
 
-	VMACRO_RETURN_MAYBE(
-		vinternal_shrink_maybe(vec));
+	vinternal_sort(out_idx->first, vec->len, sizeof(size_t), vinternal_arg_cmp,
+		vinternal_depth_limit(vec->len));
+
+	vinternal_arg_ctx.base = prev_base;
+	vinternal_arg_ctx.size = prev_size;
+	vinternal_arg_ctx.cmp = prev_cmp;
 
 	return VE_OK;
 }
 
-
-int v_swap_insert(Vec *vec, void *elem, size_t index)
+int v_apply_permutation(Vec *vec, Vec *perm)
 {
-	if (vec == NULL)
+	if (vec == NULL || perm == NULL || vec == perm)
 		return VE_INVAL;
 
-	if (elem == NULL)
-		return VE_OK;
+	if (perm->elem_size != sizeof(size_t) || perm->len != vec->len)
+		return VE_INVAL;
 
-	if (index >= vec->len)
-		return v_insert(vec, elem, index);
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
 
+	// perm is marked temporarily, snapshots must not see that
 	VMACRO_RETURN_MAYBE(
-		v_push(vec, ((char *) vec->first) + (index * vec->elem_size)));
+		vinternal_unshare(perm));
 
-	memcpy(
-		((char *) vec->first) + (index * vec->elem_size),
-		elem,
-		vec->elem_size);
+	size_t *indices = perm->first;
+	size_t len = vec->len;
 
-	return VE_OK;
-}
+	// check the bounds before marking anything, so that an index
+	// that already has the mark bit set isn't changed by unmarking
+	for (size_t i = 0; i < len; i++)
+	{
+		if (indices[i] >= len)
+			return VE_OUTOFBOUNDS;
+	}
 
-int v_swap_remove(Vec *vec, void *dest, size_t index)
-{
-	if (vec == NULL)
-		return VE_INVAL;
+	// mark every index once, rejecting duplicates
+	for (size_t i = 0; i < len; i++)
+	{
+		size_t target = indices[i] & ~VINTERNAL_PERM_MARK;
 
-	if (vec->len == 0)
-		return VE_EMPTY;
+		if (indices[target] & VINTERNAL_PERM_MARK)
+		{
+			for (size_t j = 0; j < len; j++)
+				indices[j] &= ~VINTERNAL_PERM_MARK;
 
-	if (index >= vec->len)
+			return VE_INVAL;
+		}
+
+		indices[target] |= VINTERNAL_PERM_MARK;
+	}
+
+	size_t size = vec->elem_size;
+	unsigned char small[64];
+	void *tmp = (size <= sizeof(small))
+		? small
+		: malloc(size);
+
+	if (tmp == NULL)
 	{
-		if (vinternal_c_allowoutofbounds(vec))
-			return VE_OUTOFBOUNDS;
+		for (size_t i = 0; i < len; i++)
+			indices[i] &= ~VINTERNAL_PERM_MARK;
 
-		return v_pop(vec, dest);
+		return VE_NOMEM;
 	}
 
-	void *removed = ((char *)vec->first) + (index * vec->elem_size);
+	char *base = vec->first;
 
-	if (dest != NULL)
+	// follow each cycle once, unmarking its indices on the way
+	for (size_t start = 0; start < len; start++)
 	{
-		memcpy(
-			dest,
-			removed,
-			vec->elem_size);
+		if (!(indices[start] & VINTERNAL_PERM_MARK))
+			continue;
+
+		vinternal_copy(tmp, base + (start * size), size);
+
+		for (size_t cur = start;;)
+		{
+			size_t next = indices[cur] & ~VINTERNAL_PERM_MARK;
+			indices[cur] = next;
+
+			if (next == start)
+			{
+				vinternal_copy(base + (cur * size), tmp, size);
+				break;
+			}
+
+			vinternal_copy(base + (cur * size), base + (next * size), size);
+			cur = next;
+		}
 	}
 
-	VMACRO_RETURN_MAYBE(
-		v_pop(vec, removed));
+	if (tmp != small)
+		free(tmp);
 
 	return VE_OK;
 }
 
 
-void *v_raw(Vec *vec)
+bool v_equal(Vec *a, Vec *b)
 {
-	if (vec == NULL)
-		return NULL;
-
-	if (vec->len == 0)
-		return NULL;
-
-	if (vinternal_c_rawnocopy(vec))
-		return vec->first;
+	if (a == NULL || b == NULL)
+		return false;
 
-	size_t raw_size = vec->len * vec->elem_size;
+	return vv_equal(v_view(a), v_view(b));
+}
 
-	void *raw = malloc(raw_size);
-	if (raw == NULL)
-		return NULL;
+int v_compare(Vec *a, Vec *b, VecCmp cmp)
+{
+	if (a == NULL || b == NULL)
+		return 0;
 
-	return memcpy(
-			raw,
-			vec->first,
-			raw_size);
+	return vv_compare(v_view(a), v_view(b), cmp);
 }
 
-void *v_raw_slice(Vec *vec, size_t from, size_t to)
+uint64_t v_hash(Vec *vec, uint64_t seed)
 {
 	if (vec == NULL)
-		return NULL;
-
-	if (vec->len == 0)
-		return NULL;
-
-	if (from >= to)
-		return NULL;
-
-	if (from >= vec->len)
-		return NULL;
+		return 0;
 
-	if (to >= vec->len)
-		to = vec->len - 1;
+	return vv_hash(v_view(vec), seed);
+}
 
+uint64_t v_hash_range(Vec *vec, size_t from, size_t to, uint64_t seed)
+{
+	if (vec == NULL)
+		return 0;
 
-	if (vinternal_c_rawnocopy(vec))
-		return ((char *) vec->first) + (from * vec->elem_size);
+	return vv_hash(v_view_slice(vec, from, to), seed);
+}
 
-	size_t raw_slice_size = (to - from) * vec->elem_size;
+bool vv_equal(VecView a, VecView b)
+{
+	if (a.elem_size != b.elem_size || a.len != b.len)
+		return false;
 
-	void *raw_slice = malloc(raw_slice_size);
-	if (raw_slice == NULL)
-		return NULL;
+	if (a.len == 0 || a.data == b.data)
+		return true;
 
-	return memcpy(
-			raw_slice,
-			((char *) vec->first) + (from * vec->elem_size),
-			raw_slice_size);
+	return (memcmp(a.data, b.data, a.len * a.elem_size) == 0);
 }
 
-
-Vec *v_slice(Vec *vec, size_t from, size_t to)
+int vv_compare(VecView a, VecView b, VecCmp cmp)
 {
-	if (vec == NULL)
-		return NULL;
+	if (a.elem_size != b.elem_size)
+		return 0;
 
-	if (vec->len == 0)
-		return NULL;
+	size_t len = (a.len < b.len) ? a.len : b.len;
+	size_t size = a.elem_size;
 
-	if (from >= to)
-		return NULL;
+	if (cmp == NULL)
+	{
+		int res = (len > 0) ? memcmp(a.data, b.data, len * size) : 0;
 
-	if (from >= vec->len)
-		return NULL;
+		if (res != 0)
+			return res;
+	}
+	else
+	{
+		const char *x = a.data, *y = b.data;
 
-	if (to >= vec->len)
-		to = vec->len - 1;
+		for (size_t i = 0; i < len; i++, x += size, y += size)
+		{
+			int res = cmp(x, y);
 
-	return vinternal_clone(vec, from, to, true);
+			if (res != 0)
+				return res;
+		}
+	}
+
+	return (a.len > b.len) - (a.len < b.len);
 }
 
-// rework later?
-int v_prepend(Vec *vec, void *src, size_t amount)
+uint64_t vv_hash(VecView view, uint64_t seed)
 {
-	if (vec == NULL)
-		return VE_INVAL;
+	return vinternal_hash(view.data, view.len * view.elem_size, seed);
+}
 
-	if (src == NULL || amount == 0) // implement src == NULL as special case and prepend zeroes?
-		return VE_OK;
 
-	if (vec->offset >= amount)
+size_t vv_find(VecView view, const void *elem, VecCmp cmp)
+{
+	if (elem == NULL)
+		return view.len;
+
+	const char *pos = view.data;
+
+	for (size_t i = 0; i < view.len; i++, pos += view.elem_size)
 	{
-		vec->offset -= amount;
-		vec->first = memcpy(
-			((char *) vec->data) + (vec->offset * vec->elem_size),
-			src,
-			amount * vec->elem_size);
+		int res = (cmp != NULL)
+			? cmp(pos, elem)
+			: memcmp(pos, elem, view.elem_size);
 
-		return VE_OK;
+		if (res == 0)
+			return i;
 	}
 
-	size_t new_len = vec->len + amount;
+	return view.len;
+}
 
-	VMACRO_RETURN_MAYBE(
-		vinternal_grow_maybe(vec, new_len, true));
+size_t vv_lower_bound(VecView view, const void *key, VecCmp cmp)
+{
+	if (key == NULL || cmp == NULL)
+		return view.len;
 
-	memmove(
-		((char*)vec->data) + (amount * vec->elem_size),
-		vec->first,
-		vec->len * vec->elem_size);
+	return vinternal_gallop(view.data, view.len, view.elem_size, key, cmp);
+}
 
-	vec->first = memcpy(
-		vec->data,
-		src,
-		amount * vec->elem_size);
 
-	vec->offset = 0;
-	vec->len = new_len;
+int v_sort(Vec *vec, VecCmp cmp)
+{
+	if (vec == NULL || cmp == NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
 
-	vec->last = ((char *)vec->first) + (vec->len * vec->elem_size);
+	vinternal_sort(vec->first, vec->len, vec->elem_size, cmp, vinternal_depth_limit(vec->len));
 
 	return VE_OK;
 }
-// rework later?
-int v_append(Vec *vec, void *src, size_t amount)
+
+int v_unique(Vec *vec, VecCmp cmp)
 {
 	if (vec == NULL)
 		return VE_INVAL;
 
-	if (src == NULL || amount == 0)
-		return VE_OK;
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
 
-	size_t new_len = vec->len + amount;
+	if (vec->len < 2)
+		return VE_OK;
 
-	VMACRO_RETURN_MAYBE(
-		vinternal_grow_maybe(vec, new_len, true));
+	size_t size = vec->elem_size;
+	char *write = vec->first;
 
-	if (vec->len == 0)
+	for (char *read = write + size; read != vec->last; read += size)
 	{
-		vec->first = ((char *)vec->data) + (vec->offset * vec->elem_size);
-		vec->last = vec->first;
-	}
+		int res = (cmp != NULL)
+			? cmp(write, read)
+			: memcmp(write, read, size);
 
-	vec->len = new_len;
+		if (res == 0)
+			continue;
 
-	size_t new_size = amount * vec->elem_size;
+		write += size;
 
-	memcpy(
-		vec->last,
-		src,
-		new_size);
+		if (write != read)
+			vinternal_copy(write, read, size);
+	}
 
-	vec->last = ((char *)vec->last) + new_size;
+	vec->last = write + size;
+	vec->len = (size_t) ((char *) vec->last - (char *) vec->first) / size;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_shrink_maybe(vec));
 
 	return VE_OK;
 }
 
-
-int v_trim_front(Vec *vec, void *dest, size_t amount)
+int v_sort_unique(Vec *vec, VecCmp cmp)
 {
-	if (vec == NULL)
-		return VE_INVAL;
+	VMACRO_RETURN_MAYBE(
+		v_sort(vec, cmp));
 
-	if (amount > vec->len)
-		amount = vec->len;
+	return v_unique(vec, cmp);
+}
 
-	size_t trim_size = amount * vec->elem_size;
+/**
+ * Check the common arguments of the set operations.
+ */
+static inline
+int vinternal_check_set_args(Vec *a, Vec *b, VecCmp cmp, Vec *out)
+{
+	if (a == NULL || b == NULL || cmp == NULL || out == NULL)
+		return VE_INVAL;
 
-	if (dest != NULL)
+	if (a->elem_size != out->elem_size || b->elem_size != out->elem_size
+		|| out == a || out == b)
 	{
-		memcpy(
-			dest,
-			vec->first,
-			trim_size);
+		return VE_INVAL;
 	}
 
-	vec->first = ((char *) vec->first) + trim_size;
-	vec->len -= amount;
-
-	VMACRO_RETURN_MAYBE(
-		vinternal_shrink_maybe(vec));
-
 	return VE_OK;
 }
 
-int v_trim_back(Vec *vec, void *dest, size_t amount)
+int v_set_union(Vec *a, Vec *b, VecCmp cmp, Vec *out)
 {
-	if (vec == NULL)
-		return VE_INVAL;
+	VMACRO_RETURN_MAYBE(
+		vinternal_check_set_args(a, b, cmp, out));
 
-	if (amount > vec->len)
-		amount = vec->len;
+	VMACRO_RETURN_MAYBE(
+		vinternal_prepare_out(out, vinternal_size_t_add(a->len, b->len)));
 
-	size_t trim_size = amount * vec->elem_size;
-	vec->last = ((char *) vec->last) - trim_size;
+	size_t size = out->elem_size;
+	const char *x = a->first, *x_end = a->last;
+	const char *y = b->first, *y_end = b->last;
 
-	if (dest != NULL)
+	while (x != x_end && y != y_end)
 	{
-		memcpy(
-			dest,
-			vec->last,
-			trim_size);
+		int res = cmp(x, y);
+
+		if (res <= 0)
+		{
+			vinternal_merge_emit(out, x, cmp, false);
+			x += size;
+
+			if (res == 0)
+				y += size;
+		}
+		else
+		{
+			vinternal_merge_emit(out, y, cmp, false);
+			y += size;
+		}
 	}
 
-	vec->len -= amount;
+	for (; x != x_end; x += size)
+		vinternal_merge_emit(out, x, cmp, false);
 
-	VMACRO_RETURN_MAYBE(
-		vinternal_shrink_maybe(vec));
+	for (; y != y_end; y += size)
+		vinternal_merge_emit(out, y, cmp, false);
 
 	return VE_OK;
 }
-// TODO: implement insert as insert_multiple with amount=1?
-// do trim_front and trim_back make sense as separate funcs?
-// -> can save a lot of oob checks bc conditions are guaranteed
-// -> are special cases sufficiently frequent? (probably yes)
-int v_insert_multiple(Vec *vec, void *src, size_t index, size_t amount)
+
+int v_set_intersection(Vec *a, Vec *b, VecCmp cmp, Vec *out)
 {
-	if (vec == NULL)
-		return VE_INVAL;
+	VMACRO_RETURN_MAYBE(
+		vinternal_check_set_args(a, b, cmp, out));
 
-	if (index == 0)
-		return v_prepend(vec, src, amount);
+	VMACRO_RETURN_MAYBE(
+		vinternal_prepare_out(out, (a->len < b->len) ? a->len : b->len));
 
-	if (src == NULL)
-		return VE_OK;
+	vinternal_intersect(a, b, cmp, out);
 
-	size_t index_plus_amount = index + amount;
+	return VE_OK;
+}
 
-	if (index >= vinternal_real_cap(vec))
-	{
-		if (!vinternal_c_allowoutofbounds(vec))
-			return v_append(vec, src, amount);
+int v_set_intersection_num(Vec *a, Vec *b, enum VecNum type, Vec *out)
+{
+	if (a == NULL || b == NULL || out == NULL || !vinternal_num_valid(out, type))
+		return VE_INVAL;
 
-		VMACRO_RETURN_MAYBE(
-			vinternal_grow_maybe(vec, index_plus_amount, vinternal_c_keepoffset(vec)));
-	}
+	VecCmp cmp = VINTERNAL_NUM_CMPS[type];
 
-	size_t insert_size = amount * vec->elem_size;
-	size_t size_til_index = index * vec->elem_size;
+	VMACRO_RETURN_MAYBE(
+		vinternal_check_set_args(a, b, cmp, out));
 
-	if (index >= vec->len)
-	{
-		if (!vinternal_c_allowoutofbounds(vec))
-			return v_append(vec, src, amount);
+	size_t min_len = (a->len < b->len) ? a->len : b->len;
+	size_t max_len = (a->len < b->len) ? b->len : a->len;
 
-		if (vec->len == 0)
-		{
-			vec->first = ((char *) vec->data) + (vec->offset * vec->elem_size);
-		}
+	VMACRO_RETURN_MAYBE(
+		vinternal_prepare_out(out, min_len));
 
-		memset(
-			((char *) vec->last),
-			0,
-			(index - vec->len) * vec->elem_size);
+	if (min_len * VINTERNAL_GALLOP_RATIO < max_len)
+	{
+		vinternal_intersect(a, b, cmp, out);
+		return VE_OK;
+	}
 
-		vec->last = ((char *) memcpy(
-			((char *) vec->first) + size_til_index,
-			src,
-			insert_size))
-			+ insert_size;
+	out->len = VINTERNAL_NUM_INTERSECTS[type](a->first, a->len, b->first, b->len, out->first);
+	out->last = ((char *) out->first) + (out->len * out->elem_size);
 
-		vec->len = index_plus_amount;
+	return VE_OK;
+}
 
-		return VE_OK;
-	}
+int v_set_difference(Vec *a, Vec *b, VecCmp cmp, Vec *out)
+{
+	VMACRO_RETURN_MAYBE(
+		vinternal_check_set_args(a, b, cmp, out));
 
-	size_t new_len = vec->len + amount;
-	
 	VMACRO_RETURN_MAYBE(
-		vinternal_grow_maybe(vec, new_len, vinternal_c_keepoffset(vec)));
+		vinternal_prepare_out(out, a->len));
 
-	memmove(
-		((char *) vec->first) + (index_plus_amount * vec->elem_size),
-		((char *) vec->first) + size_til_index,
-		(vec->len - index) * vec->elem_size);
+	size_t size = out->elem_size;
+	const char *x = a->first, *x_end = a->last;
+	const char *y = b->first, *y_end = b->last;
 
-	memcpy(
-		((char *) vec->first) + size_til_index,
-		src,
-		insert_size);
+	while (x != x_end && y != y_end)
+	{
+		int res = cmp(x, y);
 
-	vec->len = new_len;
+		if (res < 0)
+		{
+			vinternal_merge_emit(out, x, cmp, false);
+			x += size;
+		}
+		else
+		{
+			y += size;
+
+			if (res == 0)
+				x += size;
+		}
+	}
 
-	vec->last = ((char *) vec->last) + insert_size;
+	for (; x != x_end; x += size)
+		vinternal_merge_emit(out, x, cmp, false);
 
 	return VE_OK;
 }
-// TODO
-int v_remove_multiple(Vec *vec, void *dest, size_t index, size_t amount)
+
+
+int v_parallel_for(Vec *vec, VecRangeFn fn, void *ctx, size_t grain)
 {
-	if (vec == NULL)
+	if (vec == NULL || fn == NULL)
 		return VE_INVAL;
 
 	if (vec->len == 0)
-		return VE_EMPTY;
+		return VE_OK;
 
-	if (index == 0)
-		return v_trim_front(vec, dest, amount);
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
 
-	if (index >= vec->len)
+	struct vinternal_ForCtx for_ctx =
 	{
-		if (vinternal_c_allowoutofbounds(vec))
-			return VE_OUTOFBOUNDS;
+		.first = vec->first,
+		.len = vec->len,
+		.elem_size = vec->elem_size,
+		.grain = vinternal_grain(grain, vec->elem_size),
+		.fn = fn,
+		.ctx = ctx,
+	};
 
-		return v_trim_back(vec, dest, amount);
-	}
+	vinternal_parallel_run(vinternal_for_chunk, &for_ctx,
+		vinternal_chunk_count(for_ctx.len, for_ctx.grain));
 
-	if (amount > vec->len)
-		amount = vec->len;
+	return VE_OK;
+}
 
-	size_t remove_size = amount * vec->elem_size;
+int v_parallel_map(Vec *src, Vec *dst, VecMapFn fn, void *ctx)
+{
+	if (src == NULL || dst == NULL || fn == NULL)
+		return VE_INVAL;
 
-	if (dest != NULL)
+	if (src == dst)
 	{
-		memcpy(
-			dest,
-			((char *) vec->first) + (index * vec->elem_size),
-			remove_size);
+		VMACRO_RETURN_MAYBE(
+			vinternal_unshare(dst));
 	}
+	else
+	{
+		VMACRO_RETURN_MAYBE(
+			vinternal_prepare_out(dst, src->len));
 
-	memmove(
-		((char *) vec->first) + (index * vec->elem_size),
-		((char *) vec->first) + ((index + amount) * vec->elem_size),
-		(vec->len - index) * vec->elem_size);
+		dst->len = src->len;
+		dst->last = ((char *) dst->first) + (dst->len * dst->elem_size);
+	}
 
-	vec->len -= amount;
+	if (src->len == 0)
+		return VE_OK;
 
-	vec->last = ((char *) vec->last) - remove_size;
+	size_t size = (src->elem_size > dst->elem_size) ? src->elem_size : dst->elem_size;
 
-	VMACRO_RETURN_MAYBE(
-		vinternal_shrink_maybe(vec));
+	struct vinternal_MapCtx map_ctx =
+	{
+		.src = src->first,
+		.dst = dst->first,
+		.len = src->len,
+		.src_size = src->elem_size,
+		.dst_size = dst->elem_size,
+		.grain = vinternal_grain(0, size),
+		.fn = fn,
+		.ctx = ctx,
+	};
+
+	vinternal_parallel_run(vinternal_map_chunk, &map_ctx,
+		vinternal_chunk_count(map_ctx.len, map_ctx.grain));
 
 	return VE_OK;
 }
 
 
-Vec *v_split(Vec *vec, size_t index)
-{
-	if (vec == NULL)
-		return NULL;
+int v_sort_parallel(Vec *vec, VecCmp cmp)
+{
+	if (vec == NULL || cmp == NULL)
+		return VE_INVAL;
+
+	size_t threads = vinternal_threads();
+
+	if (vec->len < VINTERNAL_PARALLEL_SORT_MIN || threads < 2)
+		return v_sort(vec, cmp);
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_unshare(vec));
+
+	size_t size = vec->elem_size;
+	char *tmp = malloc(vec->len * size);
+
+	if (tmp == NULL)
+		return v_sort(vec, cmp);
 
-	if (index > vec->len)
-		return vinternal_c_allowoutofbounds(vec)
-			? NULL
-			: vinternal_create(vec->elem_size, 0);
+	struct vinternal_SortCtx ctx =
+	{
+		.base = vec->first,
+		.len = vec->len,
+		.elem_size = size,
+		.cmp = cmp,
+		.grain = vinternal_grain(0, size),
+	};
 
-	Vec *higher = vinternal_clone(vec, index, vec->len, true);
-	if (higher == NULL)
-		return NULL;
+	ctx.run_len = vinternal_chunk_count(ctx.len, threads);
+	ctx.run_count = vinternal_chunk_count(ctx.len, ctx.run_len);
 
-	vec->len = index;
+	vinternal_parallel_run(vinternal_sort_run, &ctx, ctx.run_count);
 
-	vinternal_shrink_maybe(vec); // check retval? vinternal_set_size doesn't corrupt vec on failure
+	ctx.src = vec->first;
+	ctx.dest = tmp;
 
-	return higher;
-}
+	for (ctx.width = ctx.run_len; ctx.width < ctx.len; ctx.width *= 2)
+	{
+		size_t pairs = vinternal_chunk_count(ctx.len, 2 * ctx.width);
+		ctx.chunks_per_pair = vinternal_chunk_count(2 * ctx.width, ctx.grain);
 
-Vec *v_clone(Vec *vec)
-{
-	if (vec == NULL)
-		return NULL;
+		vinternal_parallel_run(vinternal_sort_merge_chunk, &ctx, pairs * ctx.chunks_per_pair);
 
-	return vinternal_clone(vec, 0, vec->len, false);
-}
+		const char *src = ctx.src;
+		ctx.src = ctx.dest;
+		ctx.dest = (char *) src;
+	}
 
-Vec *v_reduced_clone(Vec *vec)
-{
-	if (vec == NULL)
-		return NULL;
+	if (ctx.src != vec->first)
+		vinternal_bulk_copy(vec->first, ctx.src, ctx.len * size, vinternal_c_parallelcopy(vec));
 
-	return vinternal_clone(vec, 0, vec->len, true);
+	free(tmp);
+
+	return VE_OK;
 }
 
-int v_zero(Vec *vec)
+int v_merge_parallel(Vec *a, Vec *b, VecCmp cmp, Vec *out, bool unique)
 {
-	if (vec == NULL)
+	if (a == NULL || b == NULL || cmp == NULL || out == NULL)
 		return VE_INVAL;
 
-	memset(vec->first, 0, (vec->len * vec->elem_size));
+	if (a->elem_size != out->elem_size || b->elem_size != out->elem_size
+		|| out == a || out == b)
+	{
+		return VE_INVAL;
+	}
 
-	return VE_OK;
-}
+	size_t len = vinternal_size_t_add(a->len, b->len);
 
-int v_softclear(Vec *vec)
-{
-	if (vec == NULL)
-		return VE_INVAL;
+	if (len < VINTERNAL_PARALLEL_SORT_MIN || vinternal_threads() < 2)
+		return v_merge(a, b, cmp, out, unique);
 
-	vec->len = 0;
+	VMACRO_RETURN_MAYBE(
+		vinternal_prepare_out(out, len));
 
-	if (!vinternal_c_keepoffset(vec))
+	struct vinternal_MergeCtx ctx =
 	{
-		vec->offset = 0;
-		vec->first = vec->data;
-	}
+		.dest = out->first,
+		.a = a->first,
+		.b = b->first,
+		.a_len = a->len,
+		.b_len = b->len,
+		.elem_size = out->elem_size,
+		.grain = vinternal_grain(0, out->elem_size),
+		.cmp = cmp,
+	};
 
-	vec->last = vec->first;
+	vinternal_parallel_run(vinternal_merge_chunk, &ctx, vinternal_chunk_count(len, ctx.grain));
+
+	out->len = len;
+	out->last = ((char *) out->first) + (len * out->elem_size);
+
+	if (unique)
+		return v_unique(out, cmp);
 
 	return VE_OK;
 }
 
-int v_destroy(Vec *vec)
+
+int v_iter_init(VecIter *iter, Vec *vec)
 {
-	if (vec == NULL)
+	if (iter == NULL || vec == NULL)
 		return VE_INVAL;
 
-	free(vec->data);
-	free(vec);
-
-	return VE_OK;
+	return vinternal_iter_init(iter, vec, 0, (size_t) SIZE_MAX, 1, false);
 }
 
-// TODO: create vinternals for iterators
 VecIter *v_iter(Vec *vec)
 {
 	if (vec == NULL)
 		return NULL;
 
-	VecIter *iter = malloc(sizeof(VecIter));
-	if (iter == NULL)
+	return vinternal_iter_create(vec, 0, (size_t) SIZE_MAX, 1, false);
+}
+
+VecIter *v_iter_range(Vec *vec, size_t from, size_t to)
+{
+	if (vec == NULL)
 		return NULL;
 
-	if (vinternal_c_iternocopy(vec))
-	{
-		if (vinternal_owned(vec))
-			return NULL;
+	if (to > vec->len)
+		to = vec->len;
 
-		iter->vec = vec;
-		iter->finger = vec->first;
+	if (from > to)
+		from = to;
 
-		return iter;
-	}
+	return vinternal_iter_create(vec, from, to - from, 1, false);
+}
 
-	iter->vec = vinternal_clone(vec, 0, vec->len, true);
-	if (iter->vec == NULL)
+VecIter *v_iter_rev(Vec *vec)
+{
+	if (vec == NULL)
 		return NULL;
 
-	iter->finger = iter->vec->first;
-	iter->vec->config |= VINTERNAL_OWNAGE_MASK;
+	size_t from = (vec->len > 0) ? vec->len - 1 : 0;
 
-	return iter;
+	return vinternal_iter_create(vec, from, vec->len, 1, true);
+}
+
+VecIter *v_iter_stride(Vec *vec, size_t start, size_t step)
+{
+	if (vec == NULL || step == 0)
+		return NULL;
+
+	return vinternal_iter_create(vec, start, (size_t) SIZE_MAX, step, false);
 }
 
 VecIter *v_into_iter(Vec **vec)
 {
-	if (vec == NULL)
+	if (vec == NULL || *vec == NULL)
 		return NULL;
 
 	if (vinternal_owned(*vec))
 		return NULL;
 
 	VecIter *iter = malloc(sizeof(VecIter));
+	if (iter == NULL)
+		return NULL;
 
-	if ((*vec)->len == 0)
+	*iter = (VecIter)
 	{
-		iter->vec = iter->finger = NULL;
+		.vec = *vec,
+		.elem_size = (*vec)->elem_size,
+		.step = 1,
+		.count = (size_t) SIZE_MAX,
+		.owner = true,
+	};
 
-		return iter;
-	}
+	vinternal_iter_sync(iter);
 
-	iter->vec = *vec;
-	*vec = NULL;
-	iter->finger = iter->vec->first;
 	iter->vec->config |= VINTERNAL_OWNAGE_MASK;
+	*vec = NULL;
 
 	return iter;
 }
 
 
-int vi_destroy(VecIter *iter)
+int vi_deinit(VecIter *iter)
 {
 	if (iter == NULL)
 		return VE_INVAL;
 
-	if (iter->vec != NULL && vinternal_owned(iter->vec))
+	struct vinternal_IterAdaptor *ad = iter->adaptor;
+
+	if (ad != NULL)
 	{
-		free(iter->vec->data);
-		free(iter->vec);
+		vi_destroy(ad->src[0]);
+
+		if (ad->src[1] != NULL)
+			vi_destroy(ad->src[1]);
+
+		free(ad->buf);
+		free(ad);
+
+		iter->adaptor = NULL;
+	}
+	else if (iter->owner)
+	{
+		iter->vec->config &= ~VINTERNAL_OWNAGE_MASK;
+		v_destroy(iter->vec);
+	}
+	else if (iter->shared != NULL)
+	{
+		vinternal_shared_release(iter->shared);
 	}
 
+	iter->vec = NULL;
+	iter->shared = NULL;
+	iter->first = NULL;
+	iter->len = 0;
+	iter->owner = false;
+
+	return VE_OK;
+}
+
+int vi_destroy(VecIter *iter)
+{
+	VMACRO_RETURN_MAYBE(
+		vi_deinit(iter));
+
 	free(iter);
 
 	return VE_OK;
@@ -1385,18 +6237,21 @@ int vi_destroy(VecIter *iter)
 
 bool vi_is_owner(VecIter *iter)
 {
-	if (iter == NULL || iter->vec == NULL)
+	if (iter == NULL)
 		return false;
 
-	return vinternal_owned(iter->vec);
+	return iter->owner || iter->shared != NULL || iter->adaptor != NULL;
 }
 
 bool vi_done(VecIter *iter)
 {
-	if (iter == NULL || iter->vec == NULL)
+	if (iter == NULL)
 		return true;
 
-	return (iter->finger == iter->vec->last);
+	if (iter->adaptor != NULL)
+		return !vinternal_adaptor_fill(iter);
+
+	return (vinternal_iter_left(iter) == 0);
 }
 
 
@@ -1405,94 +6260,354 @@ int vi_next(VecIter *iter, void *dest)
 	if (iter == NULL)
 		return VE_INVAL;
 
-	if (iter->vec == NULL || iter->finger == iter->vec->last)
+	if (iter->adaptor != NULL)
+	{
+		const void *span;
+		size_t count;
+
+		VMACRO_RETURN_MAYBE(
+			vi_next_span(iter, 1, &span, &count));
+
+		if (dest != NULL)
+			memcpy(dest, span, iter->elem_size);
+
+		return VE_OK;
+	}
+
+	if (vinternal_iter_left(iter) == 0)
 		return VE_ITERDONE;
 
 	if (dest != NULL)
 	{
 		memcpy(
 			dest,
-			iter->finger,
-			iter->vec->elem_size);
+			vinternal_iter_finger(iter),
+			iter->elem_size);
+	}
+
+	iter->pos++;
+
+	return VE_OK;
+}
+
+int vi_next_span(VecIter *iter, size_t max, const void **ptr, size_t *count)
+{
+	if (iter == NULL || ptr == NULL || count == NULL)
+		return VE_INVAL;
+
+	*ptr = NULL;
+	*count = 0;
+
+	struct vinternal_IterAdaptor *ad = iter->adaptor;
+
+	if (ad != NULL)
+	{
+		if (!vinternal_adaptor_fill(iter))
+			return VE_ITERDONE;
+
+		size_t n = (max > 0 && max < ad->out_count) ? max : ad->out_count;
+
+		*ptr = ad->out;
+		*count = n;
+
+		ad->out += n * iter->elem_size;
+		ad->out_count -= n;
+
+		return VE_OK;
 	}
 
-	iter->finger = ((char *) iter->finger) + iter->vec->elem_size;
+	size_t left = vinternal_iter_left(iter);
+
+	if (left == 0)
+		return VE_ITERDONE;
+
+	// only forward iterators over consecutive elements yield longer chunks
+	if (iter->reverse || iter->step != 1)
+		left = 1;
+
+	if (max > 0 && max < left)
+		left = max;
+
+	*ptr = vinternal_iter_finger(iter);
+	*count = left;
+
+	iter->pos += left;
 
 	return VE_OK;
 }
 
+size_t vi_next_n(VecIter *iter, void *dest, size_t n)
+{
+	if (iter == NULL)
+		return 0;
+
+	size_t total = 0;
+	const void *span;
+	size_t count;
+
+	while (total < n && vi_next_span(iter, n - total, &span, &count) == VE_OK)
+	{
+		size_t size = count * iter->elem_size;
+
+		if (dest != NULL)
+		{
+			memcpy(dest, span, size);
+			dest = ((char *) dest) + size;
+		}
+
+		total += count;
+	}
+
+	return total;
+}
+
 int vi_skip(VecIter *iter, size_t amount)
 {
 	if (iter == NULL)
 		return VE_INVAL;
 
-	if (iter->vec == NULL)
+	if (iter->adaptor != NULL)
+	{
+		vi_next_n(iter, NULL, amount);
 		return VE_OK;
-	
-	iter->finger = ((char *) iter->finger) + (amount * iter->vec->elem_size);
+	}
 
-	if (iter->finger > iter->vec->last)
-		iter->finger = iter->vec->last;
+	size_t left = vinternal_iter_left(iter);
+
+	iter->pos += (amount < left) ? amount : left;
 
 	return VE_OK;
 }
 
 int vi_goto(VecIter *iter, size_t index)
+{
+	VMACRO_RETURN_MAYBE(
+		vi_reset(iter));
+
+	return vi_skip(iter, index);
+}
+
+int vi_reset(VecIter *iter)
 {
 	if (iter == NULL)
 		return VE_INVAL;
 
-	if (iter->vec == NULL)
-		return VE_OK;
+	iter->pos = 0;
 
-	if (index >= iter->vec->len)
+	struct vinternal_IterAdaptor *ad = iter->adaptor;
+
+	if (ad != NULL)
 	{
-		iter->finger = iter->vec->last;
-		return VE_OK;
+		for (size_t i = 0; i < 2 && ad->src[i] != NULL; i++)
+		{
+			vi_reset(ad->src[i]);
+			ad->in_count[i] = 0;
+		}
+
+		ad->out_count = 0;
+		ad->left = ad->limit;
 	}
 
-	iter->finger = ((char *) iter->vec->first) + (index * iter->vec->elem_size);
+	return VE_OK;
+}
+
+
+int vi_split(VecIter *iter, VecIter **other)
+{
+	if (iter == NULL || other == NULL || iter->adaptor != NULL)
+		return VE_INVAL;
+
+	VMACRO_RETURN_MAYBE(
+		vinternal_iter_share(iter));
+
+	size_t left = vinternal_iter_left(iter);
+	size_t mid = iter->pos + (left >> 1);
+	size_t end = iter->pos + left;
+
+	*other = vinternal_iter_sub(iter, mid, end);
+	if (*other == NULL)
+		return VE_NOMEM;
+
+	iter->count = mid;
 
 	return VE_OK;
 }
 
-int vi_reset(VecIter *iter)
+int vi_split_n(VecIter *iter, size_t parts, VecIter **out_iters)
 {
-	if (iter == NULL)
+	if (iter == NULL || out_iters == NULL || parts == 0 || iter->adaptor != NULL)
 		return VE_INVAL;
 
-	if (iter->vec == NULL)
-		return VE_OK;
+	VMACRO_RETURN_MAYBE(
+		vinternal_iter_share(iter));
+
+	size_t left = vinternal_iter_left(iter);
+	size_t chunk = left / parts;
+	size_t extra = left % parts;
+	size_t pos = iter->pos;
+
+	for (size_t i = 0; i < parts; i++)
+	{
+		size_t end = pos + chunk + ((i < extra) ? 1 : 0);
+
+		out_iters[i] = vinternal_iter_sub(iter, pos, end);
 
-	iter->finger = iter->vec->first;
+		if (out_iters[i] == NULL)
+		{
+			while (i-- > 0)
+				vi_destroy(out_iters[i]);
+
+			return VE_NOMEM;
+		}
+
+		pos = end;
+	}
+
+	// all remaining elements have been handed out
+	iter->pos = pos;
 
 	return VE_OK;
 }
 
 
+VecIter *vi_map(VecIter *iter, size_t elem_size, VecMapFn map, void *ctx)
+{
+	if (iter == NULL || elem_size == 0 || map == NULL)
+		return NULL;
+
+	VecIter *mapped = vinternal_adaptor_create(VINTERNAL_ITER_MAP, iter, NULL,
+		elem_size, VINTERNAL_ITER_BATCH);
+	if (mapped == NULL)
+		return NULL;
+
+	mapped->adaptor->map = map;
+	mapped->adaptor->ctx = ctx;
+
+	return mapped;
+}
+
+VecIter *vi_filter(VecIter *iter, VecFilterFn filter, void *ctx)
+{
+	if (iter == NULL || filter == NULL)
+		return NULL;
+
+	VecIter *filtered = vinternal_adaptor_create(VINTERNAL_ITER_FILTER, iter, NULL,
+		iter->elem_size, 0);
+	if (filtered == NULL)
+		return NULL;
+
+	filtered->adaptor->filter = filter;
+	filtered->adaptor->ctx = ctx;
+
+	return filtered;
+}
+
+VecIter *vi_take(VecIter *iter, size_t n)
+{
+	if (iter == NULL)
+		return NULL;
+
+	VecIter *taken = vinternal_adaptor_create(VINTERNAL_ITER_TAKE, iter, NULL,
+		iter->elem_size, 0);
+	if (taken == NULL)
+		return NULL;
+
+	taken->adaptor->limit = taken->adaptor->left = n;
+
+	return taken;
+}
+
+VecIter *vi_zip(VecIter *a, VecIter *b)
+{
+	if (a == NULL || b == NULL || a == b)
+		return NULL;
+
+	return vinternal_adaptor_create(VINTERNAL_ITER_ZIP, a, b,
+		a->elem_size + b->elem_size, VINTERNAL_ITER_BATCH);
+}
+
+VecIter *vi_chain(VecIter *a, VecIter *b)
+{
+	if (a == NULL || b == NULL || a == b || a->elem_size != b->elem_size)
+		return NULL;
+
+	return vinternal_adaptor_create(VINTERNAL_ITER_CHAIN, a, b,
+		a->elem_size, 0);
+}
+
+Vec *vi_collect(VecIter *iter)
+{
+	if (iter == NULL)
+		return NULL;
+
+	Vec *vec = vinternal_iter_collect(iter);
+	if (vec == NULL)
+		return NULL;
+
+	vi_destroy(iter);
+
+	return vec;
+}
+
+
 Vec *vi_from_iter(VecIter *iter)
 {
-	if (iter == NULL || iter->vec == NULL)
+	if (iter == NULL)
 		return NULL;
 
-	if (vinternal_owned(iter->vec))
+	vinternal_iter_sync(iter);
+
+	bool whole = (iter->adaptor == NULL && iter->from == 0 && iter->step == 1
+		&& !iter->reverse && iter->count >= iter->len);
+
+	Vec *vec = NULL;
+
+	if (whole && iter->owner)
 	{
-		Vec *vec = iter->vec;
+		vec = iter->vec;
+		vec->config &= ~VINTERNAL_OWNAGE_MASK;
 
 		free(iter);
 
 		return vec;
 	}
 
-	Vec *vec = vinternal_clone(iter->vec, 0, iter->vec->len, false);
-	if (vec == NULL)
-		return NULL;
+	if (whole && iter->shared != NULL && VMACRO_REF_LOAD(iter->shared->refs) == 1)
+	{
+		// nothing else uses the snapshot anymore, hand out its buffer
+		struct vinternal_Shared *shared = iter->shared;
 
-	vi_destroy(iter);
+		vec = vinternal_create(iter->elem_size, 0);
+		if (vec == NULL)
+			return NULL;
 
-	return vec;
+		vec->data = shared->data;
+		vec->cap = shared->cap;
+		vec->len = iter->len;
+		vec->offset = (size_t) ((const char *) iter->first - (char *) shared->data) / iter->elem_size;
+		vec->first = ((char *) vec->data) + (vec->offset * vec->elem_size);
+		vec->last = ((char *) vec->first) + (vec->len * vec->elem_size);
+
+		free(shared);
+		free(iter);
+
+		return vec;
+	}
+
+	// partial iterators and adaptors only yield the elements they iterate over
+	vi_reset(iter);
+
+	return vi_collect(iter);
 }
 
 
 #undef VMACRO_RETURN_MAYBE
 #undef VMACRO_VERBOSE_MODE
+#undef VMACRO_DEFINE_NUM_CMP
+#undef VMACRO_DEFINE_NUM_SELECT
+#undef VMACRO_NUM_VECTOR
+#undef VMACRO_NUM_CONVERT
+#undef VMACRO_NUM_LANE
+#undef VMACRO_NUM_SELECT
+#undef VMACRO_NUM_REVERSE
+#undef VMACRO_NUM_TARGETS
@@ -5,6 +5,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 
@@ -15,10 +16,70 @@
  */
 typedef struct vinternal_Vec Vec;
 
+
+/**
+ * A non-owning, read-only view of consecutive elements of a vector.
+ * Creating and using a view never allocates or copies any elements.
+ * A view is invalidated by any operation that modifies its vector.
+ */
+typedef struct vinternal_VecView
+{
+	const void *data;
+	size_t len;
+	size_t elem_size;
+} VecView;
+
+
 /**
  * An iterator over a specified vector.
+ * Its members are internal, the type is only exposed so that
+ * iterators can be initialized in place with v_iter_init.
+ */
+typedef struct vinternal_VecIter
+{
+	Vec *vec;
+	struct vinternal_Shared *shared;
+
+	const void *first;
+	size_t len, elem_size;
+
+	size_t from, step;
+	size_t count, pos;
+
+	bool reverse, owner;
+
+	struct vinternal_IterAdaptor *adaptor;
+} VecIter;
+
+
+/**
+ * A function comparing two vector elements.
+ * Like for qsort, it returns a negative value if a is
+ * smaller than b, zero if both are equal and a positive
+ * value if a is greater than b.
+ */
+typedef int (*VecCmp)(const void *a, const void *b);
+
+/**
+ * A function transforming an element for vi_map.
+ * It writes the transformed element to dest.
+ * ctx is passed through from vi_map unchanged.
+ */
+typedef void (*VecMapFn)(void *dest, const void *elem, void *ctx);
+
+/**
+ * A function selecting elements for vi_filter.
+ * It returns true for every element that should be kept.
+ * ctx is passed through from vi_filter unchanged.
+ */
+typedef bool (*VecFilterFn)(const void *elem, void *ctx);
+
+/**
+ * A function processing a range of consecutive elements for v_parallel_for.
+ * elems points to the first of count elements, index is its index in the
+ * vector. ctx is passed through from v_parallel_for unchanged.
  */
-typedef struct vinternal_VecIter VecIter;
+typedef void (*VecRangeFn)(void *elems, size_t count, size_t index, void *ctx);
 
 
 /**
@@ -75,7 +136,7 @@ enum VecCfg
 	V_ALLOWOUTOFBOUNDS	= 1 << 2,
 
 	/**
-	 * All iterators over a vector will not create their own copy of
+	 * All iterators over a vector will not take their own snapshot of
 	 * it and instead iterate over the original vector.
 	 * Changes in the original vector will influence its iterators.
 	 */
@@ -100,6 +161,23 @@ enum VecCfg
 	 * of prepend operations are expected.
 	 */
 	V_KEEPOFFSET		= 1 << 6,
+
+	/**
+	 * All heap functions will use a 4-ary instead of a binary
+	 * heap layout. This halves the height of the heap and keeps
+	 * siblings closer together, which is faster for large heaps.
+	 * The flag must not be changed while the vector holds a heap.
+	 */
+	V_QUADHEAP			= 1 << 7,
+
+	/**
+	 * Copies of several megabytes, e.g. when cloning, appending
+	 * or reallocating the vector, are split over the threads of
+	 * the library and bypass the cache where supported.
+	 * This speeds up copying huge vectors and keeps the copy
+	 * from evicting data that is still used.
+	 */
+	V_PARALLELCOPY		= 1 << 8,
 };
 
 /**
@@ -155,6 +233,26 @@ enum VecErr
 };
 
 
+/**
+ * Numeric element types for functions with fast paths for them.
+ * The element size of the vector has to match the type.
+ */
+enum VecNum
+{
+	VN_INT32 = 0,
+	VN_INT64,
+	VN_UINT32,
+	VN_UINT64,
+	VN_FLOAT,
+	VN_DOUBLE,
+
+	/**
+	 * For internal use only.
+	 */
+	VINTERNAL_NUM_LAST,
+};
+
+
 /**
  * Set this to a non-zero value to compile with
  * log messages from vector operations enabled.
@@ -167,6 +265,8 @@ enum VecErr
 /**
  * Set the base configuration of newly created vectors.
  * Multiple config flags can be combined with '|'.
+ * Can be called from any thread, but doesn't affect
+ * threads inside of a vc_push_defaults scope.
  * 
  * @param	config	Desired configuration
  * 
@@ -177,6 +277,8 @@ extern void vc_set_base_cfg(enum VecCfg config);
 /**
  * Set the base capacity of newly created vectors.
  * The default value is VEC_DEFAULT_BASE_CAP.
+ * Can be called from any thread, but doesn't affect
+ * threads inside of a vc_push_defaults scope.
  * 
  * @param	base_cap	Desired base capacity
  */
@@ -201,6 +303,43 @@ extern void vc_set_output_stream(FILE *stream);
  */
 extern void vc_set_error_stream(FILE *stream);
 
+/**
+ * Set the amount of threads used by the parallel functions,
+ * including the calling thread. The threads are started when
+ * they are first needed. Must not be called while a parallel
+ * function is running. In particular, calling it from inside
+ * of a callback of v_parallel_for or v_parallel_map deadlocks,
+ * since the pool would have to wait for its own thread.
+ *
+ * @param	count	Amount of threads, 0 for one per online CPU
+ */
+extern void vc_set_thread_count(size_t count);
+
+/**
+ * Override the base configuration and capacity of vectors
+ * created by the calling thread until the matching call to
+ * vc_pop_defaults. Scopes can be nested up to 16 levels deep.
+ * Other threads and the global defaults are not affected.
+ *
+ * @param	config		Configuration of new vectors in this scope
+ * @param	base_cap	Base capacity of new vectors in this scope
+ * @return				Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		vc_pop_defaults
+ */
+extern int vc_push_defaults(enum VecCfg config, size_t base_cap);
+
+/**
+ * End the innermost vc_push_defaults scope of the calling thread.
+ *
+ * @return	Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		vc_push_defaults
+ */
+extern int vc_pop_defaults(void);
+
 
 /**
  * Print an appropriate error message for a vector error code.
@@ -512,9 +651,55 @@ extern void *v_raw_slice(Vec *vec, size_t from, size_t to);
  */
 extern Vec *v_slice(Vec *vec, size_t from, size_t to);
 
+/**
+ * View of all elements of a vector.
+ *
+ * @param	vec		Vector to be viewed
+ * @return			View of the vector, empty if an error has occured
+ *
+ * @see		VecView
+ */
+extern VecView v_view(Vec *vec);
+
+/**
+ * View of a range of a vector's elements.
+ * The range is clamped to the bounds of the vector.
+ *
+ * @param	vec		Vector to be viewed
+ * @param	from	Low bound index of the range
+ * @param	to		High bound index of the range, exclusive
+ * @return			View of the range, empty if an error has occured
+ *
+ * @see		VecView
+ */
+extern VecView v_view_slice(Vec *vec, size_t from, size_t to);
+
+/**
+ * View of a range of a view's elements.
+ * The range is clamped to the bounds of the view.
+ *
+ * @param	view	View to be sliced
+ * @param	from	Low bound index of the range
+ * @param	to		High bound index of the range, exclusive
+ * @return			View of the range
+ */
+extern VecView vv_slice(VecView view, size_t from, size_t to);
+
+/**
+ * Pointer to an element of a view.
+ *
+ * @param	view	View to be accessed
+ * @param	index	Index of the element
+ * @return			Pointer to the element, NULL if index is out of bounds
+ */
+extern const void *vv_at(VecView view, size_t index);
+
 
 /**
  * Prepend one or multiple elements to a vector.
+ * If there is not enough room in front of the vector,
+ * it is made in front and back at once, so repeated
+ * prepends are amortized O(1) per element.
  *
  * @param	vec		Vector to be operated on
  * @param	src		Pointer to the elements to be prepended
@@ -537,6 +722,39 @@ extern int v_prepend(Vec *vec, void *src, size_t amount);
  */
 extern int v_append(Vec *vec, void *src, size_t amount);
 
+/**
+ * Create a vector containing the elements of multiple vectors
+ * in order, allocating its buffer only once.
+ * If adopt is set, the buffer of the largest vector may be taken
+ * over instead of copying its elements. That vector is left empty.
+ *
+ * @param	vecs	Array of vectors with the same element size
+ * @param	n		Amount of vectors
+ * @param	adopt	Whether the buffer of a vector may be taken over
+ * @return			Newly created vector or NULL on failure
+ *
+ * @see		v_extend_many
+ */
+extern Vec *v_concat(Vec **vecs, size_t n, bool adopt);
+
+/**
+ * Append the elements of multiple vectors to a vector,
+ * growing it at most once.
+ * If adopt is set and a source vector is larger than the destination,
+ * its buffer may be taken over instead of copying its elements.
+ * That vector is left empty.
+ *
+ * @param	dest	Vector to be operated on
+ * @param	srcs	Array of vectors with the same element size
+ * @param	n		Amount of source vectors
+ * @param	adopt	Whether the buffer of a source vector may be taken over
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		v_concat
+ */
+extern int v_extend_many(Vec *dest, Vec **srcs, size_t n, bool adopt);
+
 
 /**
  * Trim multiple elements from the front of a vector.
@@ -618,6 +836,51 @@ extern Vec *v_clone(Vec *vec);
  */
 extern Vec *v_reduced_clone(Vec *vec);
 
+/**
+ * Swap the elements and buffers of two vectors without copying.
+ * Both vectors keep their config.
+ *
+ * @param	a		First vector to be operated on
+ * @param	b		Second vector to be operated on
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_swap(Vec *a, Vec *b);
+
+/**
+ * Move the elements and buffer of a vector to a new one without copying.
+ * The source vector is left empty.
+ *
+ * @param	vec		Vector to be taken from
+ * @return			Vector owning the buffer, NULL if an error has occured
+ */
+extern Vec *v_take(Vec *vec);
+
+/**
+ * Release the buffer of a vector to the caller, who becomes
+ * responsible for freeing it. The elements start at the beginning
+ * of the returned buffer. The vector is left empty.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	len		Pointer the amount of elements will be written to, may be NULL
+ * @return			Pointer to the buffer, NULL if the vector has
+ * 					no buffer or an error has occured
+ */
+extern void *v_into_raw(Vec *vec, size_t *len);
+
+/**
+ * Create a vector that takes over a buffer allocated with malloc.
+ * The buffer must not be used or freed by the caller afterwards.
+ *
+ * @param	ptr			Pointer to the buffer, may only be NULL if cap is 0
+ * @param	len			Amount of elements at the beginning of the buffer
+ * @param	cap			Capacity of the buffer in elements
+ * @param	elem_size	Size of one element in bytes
+ * @return				Created vector, NULL if an error has occured
+ */
+extern Vec *v_from_raw(void *ptr, size_t len, size_t cap, size_t elem_size);
+
 /**
  * Zero all elements of a vector.
  *
@@ -628,6 +891,68 @@ extern Vec *v_reduced_clone(Vec *vec);
  */
 extern int v_zero(Vec *vec);
 
+/**
+ * Set the elements in a range of a vector to copies of an element.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	elem	Pointer to the element to be copied
+ * @param	from	Low bound index of the range
+ * @param	to		High bound index of the range, exclusive
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_fill(Vec *vec, void *elem, size_t from, size_t to);
+
+/**
+ * Resize a vector to the specified length. New elements are zeroed,
+ * large extensions are taken from freshly allocated zero pages
+ * instead of being written over.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	len		Desired new length of the vector
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_resize_zeroed(Vec *vec, size_t len);
+
+/**
+ * Reverse the order of a vector's elements in place.
+ *
+ * @param	vec		Vector to be operated on
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_reverse(Vec *vec);
+
+/**
+ * Rotate a vector's elements to the left in place, so that the
+ * element at index k becomes the first one. If the vector has enough
+ * unused capacity, only the shorter part of the vector is moved.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	k		Amount of indices to rotate by, modulo the vector's length
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_rotate(Vec *vec, size_t k);
+
+/**
+ * Swap two non-overlapping ranges of a vector's elements.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	a		Low bound index of the first range
+ * @param	b		Low bound index of the second range
+ * @param	amount	Amount of elements in each range
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_swap_ranges(Vec *vec, size_t a, size_t b, size_t amount);
+
 /**
  * Clear a vector's elements while retaining its capacity.
  *
@@ -660,97 +985,975 @@ extern int v_destroy(Vec *vec);
 
 
 /**
- * Create an iterator over a vector.
+ * Sort a vector in place. The sort is not stable.
  *
- * @param	vec		Vector to be iterated over
- * @return			Pointer to new iterator, NULL if an error has occured
+ * @param	vec		Vector to be sorted
+ * @param	cmp		Function used to compare elements
+ * @return			Non-zero if an error has occured
  *
- * @see VecIter
+ * @see		VecErr
  */
-extern VecIter *v_iter(Vec *vec);
+extern int v_sort(Vec *vec, VecCmp cmp);
 
 /**
- * Create an iterator over a vector, consuming the vector.
+ * Partially sort a vector so that the element at index n is the one
+ * that would be there if the whole vector was sorted. No element before
+ * it is greater and no element after it is smaller than it.
+ * Runs in linear time on average.
  *
- * @param	vec		Vector to be consumed
- * @return			Pointer to new iterator, NULL if an error has occured
+ * @param	vec		Vector to be operated on
+ * @param	n		Index of the element to be selected
+ * @param	cmp		Function used to compare elements
+ * @return			Non-zero if an error has occured
  *
- * @see VecIter
+ * @see		VecErr
  */
-extern VecIter *v_into_iter(Vec **vec);
+extern int v_nth_element(Vec *vec, size_t n, VecCmp cmp);
 
+/**
+ * Same as v_nth_element, but compares the elements directly
+ * as the specified numeric type instead of calling a function.
+ * The order of NaNs is unspecified.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	n		Index of the element to be selected
+ * @param	type	Numeric type of the vector's elements
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		VecNum
+ */
+extern int v_nth_element_num(Vec *vec, size_t n, enum VecNum type);
 
 /**
- * Check whether an iterator owns the vector it iterates over.
+ * Sort the k smallest elements of a vector into its first k indices.
+ * The order of the remaining elements is unspecified.
  *
- * @param	iter	Iterator to be operated on
- * @return			True if the specified iterator owns
- * 					its vector, false if not or on error
+ * @param	vec		Vector to be operated on
+ * @param	k		Amount of elements to be sorted
+ * @param	cmp		Function used to compare elements
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
  */
-extern bool vi_is_owner(VecIter *iter);
+extern int v_partial_sort(Vec *vec, size_t k, VecCmp cmp);
 
 /**
- * Check whether an iterator is done iterating over its vector.
+ * Copy the k greatest elements of a vector into another vector
+ * in descending order, without modifying the source vector.
+ * Previous contents of the output vector are discarded.
  *
- * @param	iter	Iterator to be operated on
- * @return			True if the iterator is done iterating
- * 					or on error, false if not
+ * @param	vec		Vector to be operated on
+ * @param	k		Amount of elements to be selected
+ * @param	cmp		Function used to compare elements
+ * @param	out		Vector with the same element size receiving the elements
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
  */
-extern bool vi_done(VecIter *iter);
+extern int v_top_k(Vec *vec, size_t k, VecCmp cmp, Vec *out);
 
 
 /**
- * Return the element at the iterator's current position and advance it by one.
+ * Rearrange a vector into a max heap regarding cmp.
  *
- * @param	iter	Iterator to be operated on
- * @param	dest	Pointer the current element will be copied to
- * @return			VE_ITERDONE if the iterator is done, other
- * 					non-zero value if an error has occured
+ * @param	vec		Vector to be operated on
+ * @param	cmp		Function used to compare elements
+ * @return			Non-zero if an error has occured
  *
  * @see		VecErr
+ * @see		V_QUADHEAP
  */
-extern int vi_next(VecIter *iter, void *dest);
+extern int v_heap_make(Vec *vec, VecCmp cmp);
 
 /**
- * Skip amount elements of the iterator's vector.
+ * Push an element onto a heap.
  *
- * @param	iter	Iterator to be operated on
- * @param	amount	Amount of elements to be skipped
+ * @param	vec		Heap to be operated on
+ * @param	elem	Pointer to the element to be pushed
+ * @param	cmp		Function used to compare elements
  * @return			Non-zero if an error has occured
  *
  * @see		VecErr
  */
-extern int vi_skip(VecIter *iter, size_t amount);
+extern int v_heap_push(Vec *vec, void *elem, VecCmp cmp);
 
 /**
- * Set the iterator to a specified index of its vector.
+ * Remove the greatest element from a heap.
  *
- * @param	iter	Iterator to be operated on
- * @param	index	Index to be jumped to
+ * @param	vec		Heap to be operated on
+ * @param	dest	Pointer the removed element will be copied to
+ * @param	cmp		Function used to compare elements
  * @return			Non-zero if an error has occured
  *
  * @see		VecErr
  */
-extern int vi_goto(VecIter *iter, size_t index);
+extern int v_heap_pop(Vec *vec, void *dest, VecCmp cmp);
 
 /**
- * Reset an iterator to the beginning of its vector.
+ * Remove the greatest element from a heap and push another one.
+ * This is faster than a pop followed by a push.
  *
- * @param	iter	Iterator to be operated on
+ * @param	vec		Heap to be operated on
+ * @param	elem	Pointer to the element to be pushed
+ * @param	dest	Pointer the removed element will be copied to
+ * @param	cmp		Function used to compare elements
  * @return			Non-zero if an error has occured
  *
  * @see		VecErr
  */
-extern int vi_reset(VecIter *iter);
+extern int v_heap_replace(Vec *vec, void *elem, void *dest, VecCmp cmp);
 
 
 /**
- * Create a vector from an iterator, consuming the iterator.
+ * Merge two sorted vectors into another vector.
+ * The output is preallocated once and its previous contents
+ * are discarded. Equal elements keep their relative order,
+ * elements of a come before equal elements of b.
  *
- * @param	iter	Iterator to be consumed
- * @return			Pointer to new vector, NULL if an error has occured
+ * @param	a		First sorted vector
+ * @param	b		Second sorted vector
+ * @param	cmp		Function the vectors are sorted by
+ * @param	out		Vector with the same element size receiving the merge
+ * @param	unique	Only keep the first of multiple equal elements
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
  */
-extern Vec *vi_from_iter(VecIter *iter);
+extern int v_merge(Vec *a, Vec *b, VecCmp cmp, Vec *out, bool unique);
+
+/**
+ * Merge k sorted vectors into another vector using a loser tree.
+ * The output is preallocated once and its previous contents
+ * are discarded. Equal elements keep their relative order,
+ * elements of earlier vectors come before equal ones of later vectors.
+ *
+ * @param	vecs	Array of k sorted vectors
+ * @param	k		Amount of vectors to be merged
+ * @param	cmp		Function the vectors are sorted by
+ * @param	out		Vector with the same element size receiving the merge
+ * @param	unique	Only keep the first of multiple equal elements
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_merge_k(Vec **vecs, size_t k, VecCmp cmp, Vec *out, bool unique);
+
+
+/**
+ * Sum up all elements of a numeric vector.
+ * Sums of VN_INT32 and VN_INT64 are stored as int64_t, sums of
+ * VN_UINT32 and VN_UINT64 as uint64_t and sums of VN_FLOAT and
+ * VN_DOUBLE as double. Integer sums wrap around on overflow.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	type	Numeric type of the vector's elements
+ * @param	dest	Pointer the sum will be copied to
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		VecNum
+ */
+extern int v_sum(Vec *vec, enum VecNum type, void *dest);
+
+/**
+ * Get a copy of the smallest element of a numeric vector.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	type	Numeric type of the vector's elements
+ * @param	dest	Pointer the smallest element will be copied to
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		VecNum
+ */
+extern int v_min(Vec *vec, enum VecNum type, void *dest);
+
+/**
+ * Get a copy of the greatest element of a numeric vector.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	type	Numeric type of the vector's elements
+ * @param	dest	Pointer the greatest element will be copied to
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		VecNum
+ */
+extern int v_max(Vec *vec, enum VecNum type, void *dest);
+
+/**
+ * Get copies of the smallest and greatest element
+ * of a numeric vector in a single pass.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	type	Numeric type of the vector's elements
+ * @param	min		Pointer the smallest element will be copied to, may be NULL
+ * @param	max		Pointer the greatest element will be copied to, may be NULL
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		VecNum
+ */
+extern int v_minmax(Vec *vec, enum VecNum type, void *min, void *max);
+
+/**
+ * Dot product of two numeric vectors of the same length.
+ * The result is stored in the same type as by v_sum.
+ *
+ * @param	a		First vector
+ * @param	b		Second vector
+ * @param	type	Numeric type of both vectors' elements
+ * @param	dest	Pointer the dot product will be copied to
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		v_sum
+ */
+extern int v_dot(Vec *a, Vec *b, enum VecNum type, void *dest);
+
+/**
+ * Multiply all elements of a numeric vector by a factor.
+ * Integer elements wrap around on overflow.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	type	Numeric type of the vector's elements
+ * @param	factor	Pointer to the factor, of the same type as the elements
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		VecNum
+ */
+extern int v_scale(Vec *vec, enum VecNum type, const void *factor);
+
+/**
+ * Add the elements of a numeric vector to the elements
+ * at the same indices of another one of the same length.
+ * Integer elements wrap around on overflow.
+ *
+ * @param	dest	Vector to be added to
+ * @param	src		Vector to be added
+ * @param	type	Numeric type of both vectors' elements
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		VecNum
+ */
+extern int v_add_vec(Vec *dest, Vec *src, enum VecNum type);
+
+/**
+ * Same as v_sum for a view.
+ *
+ * @see		v_sum
+ */
+extern int vv_sum(VecView view, enum VecNum type, void *dest);
+
+/**
+ * Same as v_min for a view.
+ *
+ * @see		v_min
+ */
+extern int vv_min(VecView view, enum VecNum type, void *dest);
+
+/**
+ * Same as v_max for a view.
+ *
+ * @see		v_max
+ */
+extern int vv_max(VecView view, enum VecNum type, void *dest);
+
+/**
+ * Same as v_minmax for a view.
+ *
+ * @see		v_minmax
+ */
+extern int vv_minmax(VecView view, enum VecNum type, void *min, void *max);
+
+/**
+ * Same as v_dot for two views.
+ *
+ * @see		v_dot
+ */
+extern int vv_dot(VecView a, VecView b, enum VecNum type, void *dest);
+
+
+/**
+ * Inclusive prefix sum of a numeric vector: element i of the
+ * result is the sum of the elements 0 to i. Sums are computed
+ * in the element type, integers wrap around on overflow.
+ * Large vectors are scanned on multiple threads, floating point
+ * results may then differ from a sequential scan by rounding.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	type	Numeric type of the vector's elements
+ * @param	out		Vector with the same element size receiving the result,
+ * 					NULL or vec to scan in place
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		VecNum
+ */
+extern int v_inclusive_scan(Vec *vec, enum VecNum type, Vec *out);
+
+/**
+ * Exclusive prefix sum of a numeric vector: element i of the
+ * result is the sum of the elements 0 to i - 1, the first one is zero.
+ * Sums are computed in the element type, integers wrap around on overflow.
+ * Large vectors are scanned on multiple threads, floating point
+ * results may then differ from a sequential scan by rounding.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	type	Numeric type of the vector's elements
+ * @param	out		Vector with the same element size receiving the result,
+ * 					NULL or vec to scan in place
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		VecNum
+ */
+extern int v_exclusive_scan(Vec *vec, enum VecNum type, Vec *out);
+
+/**
+ * Prefix sum of a numeric vector that restarts at every index
+ * whose flag is non-zero.
+ * Like the other scans, it runs on multiple threads for large vectors.
+ *
+ * @param	vec			Vector to be operated on
+ * @param	flags		Vector of the same length with 1 byte elements
+ * 						marking the start of each segment
+ * @param	type		Numeric type of the vector's elements
+ * @param	out			Vector with the same element size receiving the result,
+ * 						NULL or vec to scan in place
+ * @param	inclusive	Whether the scan is inclusive or exclusive
+ * @return				Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		v_inclusive_scan
+ * @see		v_exclusive_scan
+ */
+extern int v_segmented_scan(Vec *vec, Vec *flags, enum VecNum type, Vec *out, bool inclusive);
+
+
+/**
+ * Copy the elements at the specified indices of a vector into another one,
+ * so that element i of the output is element idx[i] of the source.
+ *
+ * @param	src		Vector to be gathered from
+ * @param	idx		Vector of size_t indices into src
+ * @param	out		Vector with the same element size receiving the elements
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_gather(Vec *src, Vec *idx, Vec *out);
+
+/**
+ * Copy the elements of a vector to the specified indices of another one,
+ * so that element idx[i] of the destination is element i of the source.
+ *
+ * @param	dest	Vector to be scattered into
+ * @param	idx		Vector of size_t indices into dest, as long as src
+ * @param	src		Vector with the same element size to be scattered
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_scatter(Vec *dest, Vec *idx, Vec *src);
+
+/**
+ * Compute the permutation that would stably sort a vector,
+ * without moving any of its elements.
+ * Gathering the vector by the permutation yields it sorted.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	cmp		Function used to compare elements
+ * @param	out_idx	Vector with size_t elements receiving the permutation
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		v_gather
+ * @see		v_apply_permutation
+ */
+extern int v_argsort(Vec *vec, VecCmp cmp, Vec *out_idx);
+
+/**
+ * Reorder a vector in place so that element i becomes the
+ * element previously at perm[i]. Each element is moved once
+ * by following the cycles of the permutation.
+ * perm is modified temporarily, but restored before returning.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	perm	Vector of size_t indices forming a permutation
+ * 					of the indices of vec
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		v_argsort
+ */
+extern int v_apply_permutation(Vec *vec, Vec *perm);
+
+
+/**
+ * Check whether two vectors have the same element size
+ * and length and bytewise equal elements.
+ *
+ * @param	a		First vector
+ * @param	b		Second vector
+ * @return			True if both vectors are equal, false if not or on error
+ */
+extern bool v_equal(Vec *a, Vec *b);
+
+/**
+ * Compare two vectors lexicographically.
+ * If all elements of the shorter vector are equal to the
+ * first elements of the longer one, the shorter one is smaller.
+ *
+ * @param	a		First vector
+ * @param	b		Second vector with the same element size
+ * @param	cmp		Function used to compare elements, NULL to compare them bytewise
+ * @return			Negative value if a is smaller, zero if both are equal
+ * 					or on error, positive value if a is greater than b
+ */
+extern int v_compare(Vec *a, Vec *b, VecCmp cmp);
+
+/**
+ * Fast 64 bit non-cryptographic hash of a vector's elements.
+ * The hash depends on the elements' bytes in native byte order,
+ * so it is not portable between little and big endian machines.
+ *
+ * @param	vec		Vector to be hashed
+ * @param	seed	Seed of the hash
+ * @return			Hash of the vector's elements, 0 on error
+ */
+extern uint64_t v_hash(Vec *vec, uint64_t seed);
+
+/**
+ * Hash a range of a vector's elements like v_hash.
+ * Passing the hash of one range as the seed of the next one
+ * combines the hashes of several ranges. The result differs from
+ * v_hash of the whole vector and only compares equal to hashes
+ * chained over the same ranges in the same way.
+ *
+ * @param	vec		Vector to be hashed
+ * @param	from	Low bound index of the range
+ * @param	to		High bound index of the range, exclusive
+ * @param	seed	Seed of the hash
+ * @return			Hash of the range's elements, 0 on error
+ *
+ * @see		v_hash
+ */
+extern uint64_t v_hash_range(Vec *vec, size_t from, size_t to, uint64_t seed);
+
+/**
+ * Same as v_equal for two views.
+ *
+ * @see		v_equal
+ */
+extern bool vv_equal(VecView a, VecView b);
+
+/**
+ * Same as v_compare for two views.
+ *
+ * @see		v_compare
+ */
+extern int vv_compare(VecView a, VecView b, VecCmp cmp);
+
+/**
+ * Same as v_hash for a view.
+ *
+ * @see		v_hash
+ */
+extern uint64_t vv_hash(VecView view, uint64_t seed);
+
+/**
+ * Find the first element of a view that is equal to elem.
+ *
+ * @param	view	View to be searched
+ * @param	elem	Pointer to the element to be searched for
+ * @param	cmp		Function used to compare elements, NULL to compare them bytewise
+ * @return			Index of the element, length of the view if it was not found
+ */
+extern size_t vv_find(VecView view, const void *elem, VecCmp cmp);
+
+/**
+ * Find the first element of a sorted view that is not smaller than key.
+ *
+ * @param	view	Sorted view to be searched
+ * @param	key		Pointer to the element to be searched for
+ * @param	cmp		Function the view is sorted by
+ * @return			Index of the element, length of the view if
+ * 					there is none or an error has occured
+ */
+extern size_t vv_lower_bound(VecView view, const void *key, VecCmp cmp);
+
+
+/**
+ * Collapse consecutive equal elements of a vector into the first of them.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	cmp		Function used to compare elements, NULL to compare them bytewise
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_unique(Vec *vec, VecCmp cmp);
+
+/**
+ * Sort a vector and remove all duplicate elements from it.
+ *
+ * @param	vec		Vector to be operated on
+ * @param	cmp		Function used to compare elements
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		v_sort
+ * @see		v_unique
+ */
+extern int v_sort_unique(Vec *vec, VecCmp cmp);
+
+/**
+ * Union of two sorted vectors. An element occuring m times in a
+ * and n times in b occurs max(m, n) times in the output.
+ * Previous contents of the output vector are discarded.
+ *
+ * @param	a		First sorted vector
+ * @param	b		Second sorted vector
+ * @param	cmp		Function the vectors are sorted by
+ * @param	out		Vector with the same element size receiving the union
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_set_union(Vec *a, Vec *b, VecCmp cmp, Vec *out);
+
+/**
+ * Intersection of two sorted vectors. An element occuring m times in a
+ * and n times in b occurs min(m, n) times in the output.
+ * If one vector is much smaller than the other, its elements are
+ * searched for in the larger one instead of walking through both.
+ * Previous contents of the output vector are discarded.
+ *
+ * @param	a		First sorted vector
+ * @param	b		Second sorted vector
+ * @param	cmp		Function the vectors are sorted by
+ * @param	out		Vector with the same element size receiving the intersection
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_set_intersection(Vec *a, Vec *b, VecCmp cmp, Vec *out);
+
+/**
+ * Same as v_set_intersection for strictly increasing numeric vectors.
+ * Inputs of similar size are intersected by comparing whole blocks
+ * of elements at once.
+ *
+ * @param	a		First strictly increasing vector
+ * @param	b		Second strictly increasing vector
+ * @param	type	Numeric type of the vectors' elements
+ * @param	out		Vector with the same element size receiving the intersection
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		v_set_intersection
+ */
+extern int v_set_intersection_num(Vec *a, Vec *b, enum VecNum type, Vec *out);
+
+/**
+ * Difference of two sorted vectors. An element occuring m times in a
+ * and n times in b occurs max(m - n, 0) times in the output.
+ * Previous contents of the output vector are discarded.
+ *
+ * @param	a		Sorted vector to be subtracted from
+ * @param	b		Sorted vector to be subtracted
+ * @param	cmp		Function the vectors are sorted by
+ * @param	out		Vector with the same element size receiving the difference
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int v_set_difference(Vec *a, Vec *b, VecCmp cmp, Vec *out);
+
+
+/**
+ * Process the elements of a vector on multiple threads.
+ * The vector is split into ranges of grain elements, each of
+ * which is passed to fn on one of the threads of the library.
+ * fn may be called concurrently and in any order.
+ *
+ * @param	vec		Vector to be processed
+ * @param	fn		Function processing a range of elements
+ * @param	ctx		Pointer passed to fn
+ * @param	grain	Amount of elements per range, 0 to pick
+ * 					one that keeps a range in cache
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		vc_set_thread_count
+ */
+extern int v_parallel_for(Vec *vec, VecRangeFn fn, void *ctx, size_t grain);
+
+/**
+ * Transform every element of a vector on multiple threads.
+ * Previous contents of the destination vector are discarded,
+ * afterwards it has the same length as the source vector.
+ * Source and destination may be the same vector.
+ * fn may be called concurrently and in any order.
+ *
+ * @param	src		Vector to be transformed
+ * @param	dst		Vector receiving the transformed elements
+ * @param	fn		Function transforming an element
+ * @param	ctx		Pointer passed to fn
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		vc_set_thread_count
+ */
+extern int v_parallel_map(Vec *src, Vec *dst, VecMapFn fn, void *ctx);
+
+/**
+ * Sort a vector on multiple threads.
+ * Equally sized runs are sorted concurrently and then merged in
+ * rounds, each of which is again split over all threads. Short
+ * vectors are sorted sequentially. Like v_sort, the sort is not stable.
+ *
+ * @param	vec		Vector to be sorted
+ * @param	cmp		Function used to compare elements
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		v_sort
+ * @see		vc_set_thread_count
+ */
+extern int v_sort_parallel(Vec *vec, VecCmp cmp);
+
+/**
+ * Merge two sorted vectors into another vector on multiple threads.
+ * The output is split into equal ranges, the elements of the inputs
+ * ending up in each range are found with a binary search along the
+ * merge path. Short inputs are merged sequentially.
+ * Otherwise behaves exactly like v_merge.
+ *
+ * @param	a		First sorted vector
+ * @param	b		Second sorted vector
+ * @param	cmp		Function the vectors are sorted by
+ * @param	out		Vector with the same element size receiving the merge
+ * @param	unique	Only keep the first of multiple equal elements
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		v_merge
+ * @see		vc_set_thread_count
+ */
+extern int v_merge_parallel(Vec *a, Vec *b, VecCmp cmp, Vec *out, bool unique);
+
+
+/**
+ * Initialize an iterator over a vector in place, e.g. on the stack.
+ * Behaves like v_iter, but the iterator has to be
+ * released with vi_deinit instead of vi_destroy.
+ *
+ * @param	iter	Iterator to be initialized
+ * @param	vec		Vector to be iterated over
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ * @see		v_iter
+ */
+extern int v_iter_init(VecIter *iter, Vec *vec);
+
+/**
+ * Create an iterator over a vector.
+ * Unless V_ITERNOCOPY is set, the iterator works on a snapshot
+ * sharing the vector's buffer. The vector copies its elements
+ * only once it is modified while snapshots of it are alive.
+ *
+ * @param	vec		Vector to be iterated over
+ * @return			Pointer to new iterator, NULL if an error has occured
+ *
+ * @see VecIter
+ */
+extern VecIter *v_iter(Vec *vec);
+
+/**
+ * Create an iterator over a range of a vector's elements.
+ * The range is clamped to the bounds of the vector.
+ *
+ * @param	vec		Vector to be iterated over
+ * @param	from	Low bound index of the range
+ * @param	to		High bound index of the range, exclusive
+ * @return			Pointer to new iterator, NULL if an error has occured
+ *
+ * @see v_iter
+ */
+extern VecIter *v_iter_range(Vec *vec, size_t from, size_t to);
+
+/**
+ * Create an iterator over a vector's elements from last to first.
+ *
+ * @param	vec		Vector to be iterated over
+ * @return			Pointer to new iterator, NULL if an error has occured
+ *
+ * @see v_iter
+ */
+extern VecIter *v_iter_rev(Vec *vec);
+
+/**
+ * Create an iterator over every step-th element of a vector.
+ *
+ * @param	vec		Vector to be iterated over
+ * @param	start	Index of the first element
+ * @param	step	Distance between two elements, has to be non-zero
+ * @return			Pointer to new iterator, NULL if an error has occured
+ *
+ * @see v_iter
+ */
+extern VecIter *v_iter_stride(Vec *vec, size_t start, size_t step);
+
+/**
+ * Create an iterator over a vector, consuming the vector.
+ *
+ * @param	vec		Vector to be consumed
+ * @return			Pointer to new iterator, NULL if an error has occured
+ *
+ * @see VecIter
+ */
+extern VecIter *v_into_iter(Vec **vec);
+
+
+/**
+ * Check whether an iterator owns the elements it iterates over,
+ * i.e. whether they stay valid regardless of the original vector.
+ * This is the case for iterators created by v_into_iter, for
+ * snapshots (the elements are shared with the vector until it is
+ * modified) and for adaptors, which own their source iterators.
+ * Only iterators over the vector itself (V_ITERNOCOPY) don't.
+ *
+ * @param	iter	Iterator to be operated on
+ * @return			True if the specified iterator owns
+ * 					its elements, false if not or on error
+ */
+extern bool vi_is_owner(VecIter *iter);
+
+/**
+ * Check whether an iterator is done iterating over its vector.
+ *
+ * @param	iter	Iterator to be operated on
+ * @return			True if the iterator is done iterating
+ * 					or on error, false if not
+ */
+extern bool vi_done(VecIter *iter);
+
+
+/**
+ * Return the element at the iterator's current position and advance it by one.
+ *
+ * @param	iter	Iterator to be operated on
+ * @param	dest	Pointer the current element will be copied to
+ * @return			VE_ITERDONE if the iterator is done, other
+ * 					non-zero value if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int vi_next(VecIter *iter, void *dest);
+
+/**
+ * Advance an iterator over the next contiguous chunk of elements
+ * and get a pointer to them instead of copying them out.
+ * The chunk is valid as long as the iterated elements are.
+ *
+ * @param	iter	Iterator to be operated on
+ * @param	max		Maximum amount of elements in the chunk, 0 for no limit
+ * @param	ptr		Pointer the address of the chunk will be written to
+ * @param	count	Pointer the amount of elements in the chunk will be written to
+ * @return			Non-zero if an error has occured or the iterator is done
+ *
+ * @see		VecErr
+ */
+extern int vi_next_span(VecIter *iter, size_t max, const void **ptr, size_t *count);
+
+/**
+ * Copy the next n elements of an iterator to a buffer.
+ *
+ * @param	iter	Iterator to be operated on
+ * @param	dest	Buffer with room for n elements, NULL to skip them
+ * @param	n		Maximum amount of elements to be copied
+ * @return			Amount of elements copied, less than n
+ * 					if the iterator is done or an error has occured
+ */
+extern size_t vi_next_n(VecIter *iter, void *dest, size_t n);
+
+/**
+ * Skip amount elements of the iterator's vector.
+ *
+ * @param	iter	Iterator to be operated on
+ * @param	amount	Amount of elements to be skipped
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int vi_skip(VecIter *iter, size_t amount);
+
+/**
+ * Set the iterator to a specified index of the elements it iterates over.
+ *
+ * @param	iter	Iterator to be operated on
+ * @param	index	Index to be jumped to
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int vi_goto(VecIter *iter, size_t index);
+
+/**
+ * Reset an iterator to the beginning of its vector.
+ *
+ * @param	iter	Iterator to be operated on
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int vi_reset(VecIter *iter);
+
+
+/**
+ * Split the elements an iterator has left into two halves.
+ * The iterator keeps the first half, the second one goes to
+ * a new iterator. Both share the iterated elements.
+ * Adaptors cannot be split.
+ * Splitting is thread-safe: both iterators can be used and
+ * destroyed on different threads, as long as each one is only
+ * used by one thread at a time. Iterators over the vector itself
+ * (V_ITERNOCOPY) require that the vector is not modified meanwhile.
+ *
+ * @param	iter	Iterator to be split
+ * @param	other	Pointer the iterator over the second half will be written to
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int vi_split(VecIter *iter, VecIter **other);
+
+/**
+ * Split the elements an iterator has left into parts disjoint
+ * iterators of nearly the same length. They share the iterated
+ * elements, the split iterator is done afterwards.
+ * Adaptors cannot be split.
+ * Like with vi_split, the parts can be used and destroyed on
+ * different threads.
+ *
+ * @param	iter		Iterator to be split
+ * @param	parts		Amount of iterators to split into
+ * @param	out_iters	Array the parts new iterators will be written to
+ * @return				Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int vi_split_n(VecIter *iter, size_t parts, VecIter **out_iters);
+
+/**
+ * Lazily transform the elements of an iterator.
+ * Elements are transformed in batches when they are pulled from
+ * the returned iterator, chunks it yields are only valid until
+ * it is advanced again.
+ * The returned iterator takes over the source iterator, which
+ * has to be allocated by the v_iter or vi_ functions.
+ * On failure, the source iterator is left untouched.
+ *
+ * @param	iter		Source iterator
+ * @param	elem_size	Size of a transformed element
+ * @param	map			Function transforming an element
+ * @param	ctx			Pointer passed to map
+ * @return				Pointer to new iterator, NULL if an error has occured
+ */
+extern VecIter *vi_map(VecIter *iter, size_t elem_size, VecMapFn map, void *ctx);
+
+/**
+ * Lazily skip the elements of an iterator that filter rejects.
+ * Runs of accepted elements are passed through without copying.
+ * Takes over the source iterator like vi_map.
+ *
+ * @param	iter	Source iterator
+ * @param	filter	Function selecting the elements to be kept
+ * @param	ctx		Pointer passed to filter
+ * @return			Pointer to new iterator, NULL if an error has occured
+ *
+ * @see		vi_map
+ */
+extern VecIter *vi_filter(VecIter *iter, VecFilterFn filter, void *ctx);
+
+/**
+ * Lazily limit an iterator to its next n elements.
+ * Takes over the source iterator like vi_map.
+ *
+ * @param	iter	Source iterator
+ * @param	n		Maximum amount of elements
+ * @return			Pointer to new iterator, NULL if an error has occured
+ *
+ * @see		vi_map
+ */
+extern VecIter *vi_take(VecIter *iter, size_t n);
+
+/**
+ * Lazily pair up the elements of two iterators until either is done.
+ * Every element of the returned iterator consists of an element
+ * of a directly followed by an element of b.
+ * Takes over both source iterators like vi_map.
+ *
+ * @param	a		First source iterator
+ * @param	b		Second source iterator
+ * @return			Pointer to new iterator, NULL if an error has occured
+ *
+ * @see		vi_map
+ */
+extern VecIter *vi_zip(VecIter *a, VecIter *b);
+
+/**
+ * Lazily iterate over the elements of a, then over those of b.
+ * Takes over both source iterators like vi_map.
+ *
+ * @param	a		First source iterator
+ * @param	b		Second source iterator with the same element size
+ * @return			Pointer to new iterator, NULL if an error has occured
+ *
+ * @see		vi_map
+ */
+extern VecIter *vi_chain(VecIter *a, VecIter *b);
+
+/**
+ * Create a vector from the elements an iterator has left, consuming
+ * the iterator. The vector is sized up front as far as the amount
+ * of elements is known.
+ * Only use this with iterators that have been allocated by the
+ * v_iter or vi_ functions, it frees the iterator.
+ *
+ * @param	iter	Iterator to be consumed
+ * @return			Pointer to new vector, NULL if an error has occured
+ */
+extern Vec *vi_collect(VecIter *iter);
+
+/**
+ * Create a vector from an iterator, consuming the iterator.
+ * Iterators over a part of a vector yield a vector of all
+ * elements they iterate over.
+ * Only use this with iterators that have been allocated by the
+ * v_iter or vi_ functions, it frees the iterator.
+ *
+ * @param	iter	Iterator to be consumed
+ * @return			Pointer to new vector, NULL if an error has occured
+ */
+extern Vec *vi_from_iter(VecIter *iter);
+
+/**
+ * Release the elements of an iterator initialized with
+ * v_iter_init without freeing the iterator itself.
+ *
+ * @param	iter	Iterator to be released
+ * @return			Non-zero if an error has occured
+ *
+ * @see		VecErr
+ */
+extern int vi_deinit(VecIter *iter);
 
 /**
  * Destroy an iterator.